@@ -28,14 +28,26 @@
 #include "util.h"
 #include "../util/bits.h"
 
+// Use kindergarten rook attacks instead of black magics when
+// pext is unavailable or slow. Ignored if pext is usable
+#ifndef OJ_KINDERGARTEN_ROOKS
+	#define OJ_KINDERGARTEN_ROOKS 0
+#endif
+
+#include "kindergarten/attacks.h"
+
 #if OJ_HAS_BMI2
 #include "bmi2/attacks.h"
-#else
+#elif !OJ_KINDERGARTEN_ROOKS
 #include "black_magic/attacks.h"
 #endif
 
 namespace oranj::attacks
 {
+#if !OJ_HAS_BMI2 && OJ_KINDERGARTEN_ROOKS
+	using kindergarten::getRookAttacks;
+#endif
+
 	constexpr auto AlfilAttacks = []
 	{
 		std::array<Bitboard, 64> dst{};
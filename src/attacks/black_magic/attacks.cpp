@@ -18,7 +18,7 @@
 
 #include "../attacks.h"
 
-#if !OJ_HAS_BMI2
+#if !OJ_HAS_BMI2 && !OJ_KINDERGARTEN_ROOKS
 namespace oranj::attacks
 {
 	using namespace black_magic;
@@ -63,4 +63,4 @@ namespace oranj::attacks
 
 	const std::array<Bitboard, RookData.tableSize> RookAttacks = generateRookAttacks();
 }
-#endif // !OJ_HAS_BMI2
+#endif // !OJ_HAS_BMI2 && !OJ_KINDERGARTEN_ROOKS
@@ -19,12 +19,24 @@
 #include "bench.h"
 
 #include <array>
+#include <algorithm>
+#include <memory>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string_view>
 
 #include "position/position.h"
+#include "attacks/attacks.h"
+#include "movegen.h"
+#include "datagen/marlinformat.h"
+#include "util/mapped_file.h"
+#include "util/rng.h"
+#include "util/timer.h"
 
 namespace oranj::bench
 {
-	auto run(search::Searcher &searcher, i32 depth) -> void
+	namespace
 	{
 		const std::array Fens { // fens from alexandria, ultimately from bitgenie
 			"r5r1/1k6/1pqb4/1Bppn1p1/P1n1p2p/P1N1P2P/2KQ1p2/1RBR2N1 w - - 0 45",
@@ -49,6 +61,49 @@ namespace oranj::bench
 			"8/4k3/4R3/2PK4/1P3Nn1/P2PPn2/5r2/8 b - - 2 58",
 		};
 
+		constexpr usize FenBenchPositions = 1 << 20;
+		constexpr usize FenBenchMaxPlies = 64;
+
+		// fens along random playouts from the bench positions, one per line
+		auto generateFens(usize count) -> std::string
+		{
+			std::string fens{};
+			fens.reserve(count * 64);
+
+			util::rng::Jsf64Rng rng{0x6F72616E6A};
+
+			Position pos{};
+			ScoredMoveList moves{};
+
+			usize generated = 0;
+
+			while (generated < count)
+			{
+				pos.resetFromFen(Fens[rng.nextU32(Fens.size())]);
+
+				for (usize ply = 0; ply < FenBenchMaxPlies && generated < count; ++ply)
+				{
+					pos.writeFen(fens);
+					fens += '\n';
+
+					++generated;
+
+					moves.clear();
+					generateLegal(moves, pos);
+
+					if (moves.empty())
+						break;
+
+					pos.applyMoveUnchecked<false, false>(moves[rng.nextU32(moves.size())].move, nullptr);
+				}
+			}
+
+			return fens;
+		}
+	}
+
+	auto run(search::Searcher &searcher, i32 depth) -> void
+	{
 		searcher.newGame();
 
 		usize nodes{};
@@ -71,4 +126,209 @@ namespace oranj::bench
 		std::cout << "info string " << time << " seconds" << std::endl;
 		std::cout << nodes << " nodes " << static_cast<usize>(static_cast<f64>(nodes) / time) << " nps" << std::endl;
 	}
+
+	auto runRookBench() -> void
+	{
+		static constexpr usize Passes = 20000;
+
+#if OJ_HAS_BMI2
+		static constexpr auto BuildImpl = "pext";
+#elif OJ_KINDERGARTEN_ROOKS
+		static constexpr auto BuildImpl = "kindergarten";
+#else
+		static constexpr auto BuildImpl = "black magic";
+#endif
+
+		// every square against the occupancy of every bench position
+		std::vector<std::pair<Square, Bitboard>> samples{};
+		samples.reserve(Fens.size() * 64);
+
+		Position pos{};
+
+		for (const auto &fen : Fens)
+		{
+			if (!pos.resetFromFen(fen))
+				return;
+
+			for (i32 square = 0; square < 64; ++square)
+			{
+				samples.emplace_back(static_cast<Square>(square), pos.bbs().occupancy());
+			}
+		}
+
+		for (const auto [square, occupancy] : samples)
+		{
+			if (attacks::getRookAttacks(square, occupancy) != attacks::kindergarten::getRookAttacks(square, occupancy))
+			{
+				std::cerr << "rook attack mismatch on " << squareToString(square)
+					<< " with occupancy 0x" << std::hex << static_cast<u64>(occupancy) << std::dec << std::endl;
+				return;
+			}
+		}
+
+		const auto time = [&](std::string_view name, auto getAttacks)
+		{
+			u64 sink{};
+
+			const auto start = util::Instant::now();
+
+			for (usize pass = 0; pass < Passes; ++pass)
+			{
+				for (const auto [square, occupancy] : samples)
+				{
+					sink += getAttacks(square, occupancy);
+				}
+			}
+
+			const auto elapsed = start.elapsed();
+			const auto calls = static_cast<f64>(Passes * samples.size());
+
+			std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+				<< std::setw(8) << std::setprecision(3) << elapsed * 1e9 / calls << " ns/call  "
+				<< std::setw(8) << std::setprecision(1) << calls / elapsed / 1e6 << " M calls/s"
+				<< std::defaultfloat << "  (" << std::hex << (sink & 0xFFFF) << std::dec << ")\n";
+		};
+
+		std::cout << samples.size() << " samples, " << Passes << " passes\n";
+
+		time(std::string{"build ("} + BuildImpl + ")", [](Square square, Bitboard occupancy)
+		{
+			return attacks::getRookAttacks(square, occupancy);
+		});
+
+		time("kindergarten", [](Square square, Bitboard occupancy)
+		{
+			return attacks::kindergarten::getRookAttacks(square, occupancy);
+		});
+
+		std::cout << std::flush;
+	}
+
+	auto runFenBench(const std::optional<std::string> &path) -> bool
+	{
+		std::unique_ptr<util::MappedFile> file{};
+		std::string generated{};
+
+		std::string_view fens{};
+
+		if (path)
+		{
+			file = util::MappedFile::open(*path);
+
+			if (!file)
+			{
+				std::cerr << "failed to open fen file " << *path << std::endl;
+				return false;
+			}
+
+			fens = std::string_view{file->data().data(), file->data().size()};
+		}
+		else
+		{
+			generated = generateFens(FenBenchPositions);
+			fens = generated;
+		}
+
+		std::vector<std::string_view> lines{};
+
+		for (auto remaining = fens; !remaining.empty();)
+		{
+			const auto end = std::min(remaining.find('\n'), remaining.size());
+			const auto line = remaining.substr(0, end);
+
+			remaining.remove_prefix(std::min(end + 1, remaining.size()));
+
+			if (line.find_first_not_of(" \t\r") != std::string_view::npos)
+				lines.push_back(line);
+		}
+
+		if (lines.empty())
+		{
+			std::cerr << "no fens to benchmark" << std::endl;
+			return false;
+		}
+
+		Position pos{};
+		Position roundTripped{};
+
+		std::string fen{};
+
+		// everything written back out must parse to the same position
+		for (usize i = 0; i < lines.size(); ++i)
+		{
+			if (!pos.resetFromFen(lines[i]))
+			{
+				std::cerr << "invalid fen on line " << (i + 1) << std::endl;
+				return false;
+			}
+
+			fen.clear();
+			pos.writeFen(fen);
+
+			if (!roundTripped.resetFromFen(fen) || !(roundTripped == pos))
+			{
+				std::cerr << "fen on line " << (i + 1) << " did not round trip: " << fen << std::endl;
+				return false;
+			}
+		}
+
+		const auto report = [&](std::string_view name, f64 elapsed, usize sink)
+		{
+			const auto count = static_cast<f64>(lines.size());
+
+			std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+				<< std::setw(8) << std::setprecision(1) << elapsed * 1e9 / count << " ns/fen  "
+				<< std::setw(8) << std::setprecision(2) << count / elapsed / 1e6 << " M fens/s"
+				<< std::defaultfloat << "  (" << sink << ")\n";
+		};
+
+		const auto time = [&](std::string_view name, auto perFen)
+		{
+			usize sink{};
+
+			const auto start = util::Instant::now();
+
+			for (const auto line : lines)
+			{
+				sink += perFen(line);
+			}
+
+			report(name, start.elapsed(), sink);
+		};
+
+		std::cout << lines.size() << " fens\n";
+
+		time("resetFromFen", [&](std::string_view line)
+		{
+			return static_cast<usize>(pos.resetFromFen(line));
+		});
+
+		time("resetFromFen + writeFen", [&](std::string_view line)
+		{
+			pos.resetFromFen(line);
+
+			fen.clear();
+			pos.writeFen(fen);
+
+			return fen.size();
+		});
+
+		time("resetFromFen + toFen", [&](std::string_view line)
+		{
+			pos.resetFromFen(line);
+			return pos.toFen().size();
+		});
+
+		std::vector<datagen::marlinformat::PackedBoard> packed{};
+		packed.reserve(lines.size());
+
+		const auto start = util::Instant::now();
+		const auto failed = datagen::marlinformat::packFens(fens, packed);
+
+		report("packFens (batch)", start.elapsed(), packed.size());
+
+		std::cout << std::flush;
+
+		return failed == 0;
+	}
 }
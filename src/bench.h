@@ -20,6 +20,9 @@
 
 #include "types.h"
 
+#include <optional>
+#include <string>
+
 #include "search.h"
 
 namespace oranj::bench
@@ -33,4 +36,11 @@ namespace oranj::bench
 	constexpr usize DefaultBenchTtSize = 16;
 
 	auto run(search::Searcher &searcher, i32 depth = DefaultBenchDepth) -> void;
+
+	// times getRookAttacks() as built against the kindergarten implementation
+	auto runRookBench() -> void;
+
+	// times fen parsing and writing over the fens in a file, one per line,
+	// or over fens from random playouts if no file is given
+	auto runFenBench(const std::optional<std::string> &path) -> bool;
 }
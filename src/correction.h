@@ -47,6 +47,16 @@ namespace oranj
 			std::memset(&m_contTable, 0, sizeof(m_contTable));
 		}
 
+		// scales every entry by scale / 1024
+		inline auto age(i32 scale)
+		{
+			ageTable(m_pawnTable, scale);
+			ageTable(m_blackNonPawnTable, scale);
+			ageTable(m_whiteNonPawnTable, scale);
+			ageTable(m_majorTable, scale);
+			ageTable(m_contTable, scale);
+		}
+
 		inline auto update(const Position &pos, std::span<search::PlayedMove> moves,
 			i32 ply, i32 depth, Score searchScore, Score staticEval)
 		{
@@ -128,6 +138,19 @@ namespace oranj
 			}
 		};
 
+		template <typename T>
+		static inline auto ageTable(T &table, i32 scale) -> void
+		{
+			static_assert(sizeof(T) % sizeof(Entry) == 0);
+
+			auto *entries = reinterpret_cast<Entry *>(&table);
+
+			for (usize i = 0; i < sizeof(T) / sizeof(Entry); ++i)
+			{
+				entries[i].value = static_cast<i16>(entries[i].value * scale / 1024);
+			}
+		}
+
 		util::MultiArray<Entry, 2, Entries> m_pawnTable{};
 		util::MultiArray<Entry, 2, Entries> m_blackNonPawnTable{};
 		util::MultiArray<Entry, 2, Entries> m_whiteNonPawnTable{};
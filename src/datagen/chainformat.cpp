@@ -0,0 +1,520 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "chainformat.h"
+
+#include <bit>
+#include <span>
+#include <cstring>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+
+#include "../movegen.h"
+#include "../3rdparty/zstd/zstd.h"
+
+namespace oranj::datagen
+{
+	namespace
+	{
+		// generation order must never change, or existing files become unreadable
+		auto generateLegal(MoveList &moves, const Position &pos)
+		{
+			ScoredMoveList generated{};
+			generateAll(generated, pos);
+
+			for (const auto [move, _s] : generated)
+			{
+				if (pos.isLegal(move))
+					moves.push(move);
+			}
+		}
+
+		[[nodiscard]] constexpr auto indexBits(usize legalMoves) -> u32
+		{
+			return legalMoves <= 1 ? 0 : static_cast<u32>(std::bit_width(legalMoves - 1));
+		}
+
+		[[nodiscard]] constexpr auto zigzag(i32 v) -> u32
+		{
+			return (static_cast<u32>(v) << 1) ^ static_cast<u32>(v >> 31);
+		}
+
+		[[nodiscard]] constexpr auto unzigzag(u32 v) -> i32
+		{
+			return static_cast<i32>(v >> 1) ^ -static_cast<i32>(v & 1);
+		}
+
+		auto writeVarint(std::vector<u8> &dst, u32 value)
+		{
+			while (value >= 0x80)
+			{
+				dst.push_back(static_cast<u8>(value | 0x80));
+				value >>= 7;
+			}
+
+			dst.push_back(static_cast<u8>(value));
+		}
+
+		class BitWriter
+		{
+		public:
+			explicit BitWriter(std::vector<u8> &dst) : m_dst{dst} {}
+
+			inline auto write(u32 value, u32 bits)
+			{
+				assert(bits <= 32);
+				assert(bits == 32 || value < (u32{1} << bits));
+
+				m_buffer |= static_cast<u64>(value) << m_bitCount;
+				m_bitCount += bits;
+
+				while (m_bitCount >= 8)
+				{
+					m_dst.push_back(static_cast<u8>(m_buffer));
+
+					m_buffer >>= 8;
+					m_bitCount -= 8;
+				}
+			}
+
+			// pads to a byte boundary
+			inline auto flush()
+			{
+				if (m_bitCount > 0)
+					m_dst.push_back(static_cast<u8>(m_buffer));
+
+				m_buffer = 0;
+				m_bitCount = 0;
+			}
+
+		private:
+			std::vector<u8> &m_dst;
+
+			u64 m_buffer{};
+			u32 m_bitCount{};
+		};
+
+		class ByteReader
+		{
+		public:
+			ByteReader(std::span<const u8> data, usize &offset)
+				: m_data{data},
+				  m_offset{offset} {}
+
+			[[nodiscard]] inline auto read(void *dst, usize size) -> bool
+			{
+				if (m_data.size() - m_offset < size)
+					return false;
+
+				std::memcpy(dst, &m_data[m_offset], size);
+				m_offset += size;
+
+				return true;
+			}
+
+			[[nodiscard]] inline auto readVarint() -> std::optional<u32>
+			{
+				u32 value{};
+
+				for (u32 shift = 0; shift < 32; shift += 7)
+				{
+					if (m_offset >= m_data.size())
+						return {};
+
+					const auto byte = m_data[m_offset++];
+					value |= static_cast<u32>(byte & 0x7F) << shift;
+
+					if ((byte & 0x80) == 0)
+						return value;
+				}
+
+				return {};
+			}
+
+			[[nodiscard]] inline auto readBits(u32 bits) -> std::optional<u32>
+			{
+				while (m_bitCount < bits)
+				{
+					if (m_offset >= m_data.size())
+						return {};
+
+					m_buffer |= static_cast<u64>(m_data[m_offset++]) << m_bitCount;
+					m_bitCount += 8;
+				}
+
+				const auto value = static_cast<u32>(m_buffer & ((u64{1} << bits) - 1));
+
+				m_buffer >>= bits;
+				m_bitCount -= bits;
+
+				return value;
+			}
+
+			// skips the padding at the end of a bitstream
+			inline auto alignToByte()
+			{
+				m_buffer = 0;
+				m_bitCount = 0;
+			}
+
+		private:
+			std::span<const u8> m_data;
+			usize &m_offset;
+
+			u64 m_buffer{};
+			u32 m_bitCount{};
+		};
+	}
+
+	namespace chainformat
+	{
+		Reader::Reader(std::istream &stream)
+			: m_stream{stream} {}
+
+		auto Reader::next(viriformat::Game &game) -> bool
+		{
+			if (m_failed)
+				return false;
+
+			while (m_offset == m_block.size())
+			{
+				if (!readBlock())
+					return false;
+			}
+
+			const auto fail = [this](const char *reason)
+			{
+				std::cerr << "malformed chainformat game: " << reason << std::endl;
+				m_failed = true;
+				return false;
+			};
+
+			ByteReader reader{m_block, m_offset};
+
+			if (!reader.read(&game.initial, sizeof(marlinformat::PackedBoard)))
+				return fail("truncated initial position");
+
+			if (!game.initial.unpack(m_pos))
+				return fail("invalid initial position");
+
+			const auto moveCount = reader.readVarint();
+
+			if (!moveCount)
+				return fail("truncated move count");
+
+			game.moves.clear();
+			game.moves.reserve(*moveCount);
+
+			i32 score{};
+
+			for (u32 i = 0; i < *moveCount; ++i)
+			{
+				const auto delta = reader.readVarint();
+
+				if (!delta)
+					return fail("truncated scores");
+
+				score += unzigzag(*delta);
+				game.moves.emplace_back(NullMove, static_cast<i16>(score));
+			}
+
+			for (auto &[move, _score] : game.moves)
+			{
+				MoveList legal{};
+				generateLegal(legal, m_pos);
+
+				if (legal.empty())
+					return fail("move after the end of the game");
+
+				const auto index = reader.readBits(indexBits(legal.size()));
+
+				if (!index)
+					return fail("truncated moves");
+
+				if (*index >= legal.size())
+					return fail("move index out of range");
+
+				move = legal[*index];
+				m_pos.applyMoveUnchecked<false, false>(move, nullptr);
+			}
+
+			reader.alignToByte();
+
+			return true;
+		}
+
+		auto Reader::readBlock() -> bool
+		{
+			BlockHeader header{};
+
+			if (!m_stream.read(reinterpret_cast<char *>(&header), sizeof(BlockHeader)))
+			{
+				if (m_stream.gcount() != 0)
+				{
+					std::cerr << "truncated chainformat block header" << std::endl;
+					m_failed = true;
+				}
+
+				return false;
+			}
+
+			if (header.magic != Magic || header.version != Version)
+			{
+				std::cerr << "invalid chainformat block header" << std::endl;
+				m_failed = true;
+				return false;
+			}
+
+			std::vector<u8> stored(header.storedSize);
+
+			if (!m_stream.read(reinterpret_cast<char *>(stored.data()), header.storedSize))
+			{
+				std::cerr << "truncated chainformat block" << std::endl;
+				m_failed = true;
+				return false;
+			}
+
+			++m_blocks;
+
+			if ((header.flags & ZstdCompressedFlag) != 0)
+			{
+				++m_compressedBlocks;
+
+				m_block.resize(header.rawSize);
+
+				const auto result = ZSTD_decompress(m_block.data(), m_block.size(), stored.data(), stored.size());
+
+				if (ZSTD_isError(result) || result != header.rawSize)
+				{
+					std::cerr << "failed to decompress chainformat block" << std::endl;
+					m_failed = true;
+					return false;
+				}
+			}
+			else if (header.rawSize != header.storedSize)
+			{
+				std::cerr << "invalid uncompressed chainformat block size" << std::endl;
+				m_failed = true;
+				return false;
+			}
+			else m_block = std::move(stored);
+
+			m_offset = 0;
+
+			return true;
+		}
+
+		auto verify(const std::string &viriformatPath) -> i32
+		{
+			std::ifstream in{viriformatPath, std::ios::binary};
+
+			if (!in)
+			{
+				std::cerr << "failed to open " << viriformatPath << std::endl;
+				return 1;
+			}
+
+			std::stringstream encoded{std::ios::in | std::ios::out | std::ios::binary};
+
+			Chainformat output{};
+			std::vector<viriformat::Game> games{};
+
+			usize viriBytes{};
+
+			Position pos{};
+
+			for (viriformat::Game game{}; viriformat::readGame(in, game);)
+			{
+				if (!game.initial.unpack(pos))
+				{
+					std::cerr << "invalid initial position in game " << games.size() << std::endl;
+					return 1;
+				}
+
+				output.start(pos);
+
+				for (const auto [move, score] : game.moves)
+				{
+					if (!pos.isPseudolegal(move) || !pos.isLegal(move))
+					{
+						std::cerr << "illegal move in game " << games.size() << std::endl;
+						return 1;
+					}
+
+					output.push(false, move, score);
+					pos.applyMoveUnchecked<false, false>(move, nullptr);
+				}
+
+				output.writeAllWithOutcome(encoded, game.initial.wdl);
+
+				viriBytes += sizeof(marlinformat::PackedBoard) + (game.moves.size() + 1) * 2 * sizeof(u16);
+				games.push_back(std::move(game));
+			}
+
+			output.finish(encoded);
+
+			const auto chainBytes = encoded.str().size();
+
+			Reader reader{encoded};
+			viriformat::Game decoded{};
+
+			for (usize i = 0; i < games.size(); ++i)
+			{
+				const auto &expected = games[i];
+
+				if (!reader.next(decoded))
+				{
+					std::cerr << "failed to decode game " << i << std::endl;
+					return 1;
+				}
+
+				if (std::memcmp(&decoded.initial, &expected.initial, sizeof(marlinformat::PackedBoard)) != 0
+					|| decoded.moves != expected.moves)
+				{
+					std::cerr << "game " << i << " does not round trip" << std::endl;
+					return 1;
+				}
+			}
+
+			if (reader.next(decoded) || reader.failed())
+			{
+				std::cerr << "unexpected data after the last game" << std::endl;
+				return 1;
+			}
+
+			std::cout << games.size() << " games round tripped, " << viriBytes << " bytes as viriformat, "
+				<< chainBytes << " bytes as chainformat ("
+				<< (static_cast<f64>(chainBytes) / static_cast<f64>(std::max<usize>(viriBytes, 1)) * 100.0)
+				<< "%), " << reader.compressedBlocks() << " of " << reader.blocks()
+				<< " blocks compressed" << std::endl;
+
+			return 0;
+		}
+	}
+
+	Chainformat::Chainformat()
+	{
+		m_moveIndices.reserve(256);
+		m_scores.reserve(256);
+		m_block.reserve(TargetBlockSize + 64 * 1024);
+		m_compressed.reserve(ZSTD_compressBound(m_block.capacity()));
+
+		m_cctx = ZSTD_createCCtx();
+		ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_compressionLevel, CompressionLevel);
+	}
+
+	Chainformat::~Chainformat()
+	{
+		ZSTD_freeCCtx(m_cctx);
+	}
+
+	auto Chainformat::start(const Position &initialPosition) -> void
+	{
+		m_initial = marlinformat::PackedBoard::pack(initialPosition, 0);
+		m_curr.copyStateFrom(initialPosition);
+
+		m_moveIndices.clear();
+		m_scores.clear();
+	}
+
+	auto Chainformat::push([[maybe_unused]] bool filtered, Move move, Score score) -> void
+	{
+		MoveList legal{};
+		generateLegal(legal, m_curr);
+
+		const auto index = static_cast<u32>(std::ranges::find(legal, move) - legal.begin());
+		assert(index < legal.size());
+
+		m_moveIndices.emplace_back(index, indexBits(legal.size()));
+		m_scores.push_back(static_cast<i16>(score));
+
+		m_curr.applyMoveUnchecked<false, false>(move, nullptr);
+	}
+
+	auto Chainformat::writeAllWithOutcome(std::ostream &stream, Outcome outcome) -> usize
+	{
+		m_initial.wdl = outcome;
+
+		const auto *initial = reinterpret_cast<const u8 *>(&m_initial);
+		m_block.insert(m_block.end(), initial, initial + sizeof(marlinformat::PackedBoard));
+
+		writeVarint(m_block, static_cast<u32>(m_scores.size()));
+
+		i32 prevScore{};
+
+		for (const auto score : m_scores)
+		{
+			writeVarint(m_block, zigzag(score - prevScore));
+			prevScore = score;
+		}
+
+		BitWriter bits{m_block};
+
+		for (const auto [index, bitCount] : m_moveIndices)
+		{
+			bits.write(index, bitCount);
+		}
+
+		bits.flush();
+
+		if (m_block.size() >= TargetBlockSize)
+			writeBlock(stream);
+
+		return m_scores.size() + 1;
+	}
+
+	auto Chainformat::finish(std::ostream &stream) -> void
+	{
+		if (!m_block.empty())
+			writeBlock(stream);
+
+		stream.flush();
+	}
+
+	auto Chainformat::writeBlock(std::ostream &stream) -> void
+	{
+		m_compressed.resize(ZSTD_compressBound(m_block.size()));
+
+		const auto compressedSize = ZSTD_compress2(m_cctx, m_compressed.data(), m_compressed.size(),
+			m_block.data(), m_block.size());
+
+		// incompressible blocks are stored raw
+		const bool compressed = !ZSTD_isError(compressedSize) && compressedSize < m_block.size();
+
+		const auto &payload = compressed ? m_compressed : m_block;
+		const auto payloadSize = compressed ? compressedSize : m_block.size();
+
+		const chainformat::BlockHeader header{
+			.magic = chainformat::Magic,
+			.version = chainformat::Version,
+			.flags = compressed ? chainformat::ZstdCompressedFlag : u8{0},
+			.reserved = 0,
+			.rawSize = static_cast<u32>(m_block.size()),
+			.storedSize = static_cast<u32>(payloadSize),
+		};
+
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(chainformat::BlockHeader));
+		stream.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(payloadSize));
+
+		m_block.clear();
+	}
+}
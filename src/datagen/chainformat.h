@@ -0,0 +1,155 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+#include "common.h"
+#include "format.h"
+#include "marlinformat.h"
+#include "viriformat.h"
+#include "../position/position.h"
+#include "../3rdparty/zstd/zstd.h"
+
+namespace oranj::datagen
+{
+	// Compact chained-move format. The file is a sequence of blocks, each a
+	// BlockHeader followed by its payload, zstd compressed unless that would not
+	// make it smaller. An uncompressed payload is a sequence of games:
+	//  - initial position as a marlinformat PackedBoard, wdl holding the outcome
+	//  - move count, as a LEB128 varint
+	//  - one zigzag LEB128 varint per move, the delta of its score from the previous
+	//  - one index into the legal move list (in generation order) per move, packed
+	//    into a bitstream with ceil(log2(legal move count)) bits each, padded to a byte
+	namespace chainformat
+	{
+		struct __attribute__((packed)) BlockHeader
+		{
+			std::array<char, 4> magic;
+			u8 version;
+			u8 flags;
+			[[maybe_unused]] u16 reserved;
+			u32 rawSize;
+			u32 storedSize;
+		};
+
+		static_assert(sizeof(BlockHeader) == 16);
+
+		constexpr std::array Magic{'O', 'J', 'C', 'F'};
+		constexpr u8 Version = 1;
+
+		// payload is a single zstd frame that decompresses to rawSize bytes
+		constexpr u8 ZstdCompressedFlag = 1 << 0;
+
+		class Reader
+		{
+		public:
+			explicit Reader(std::istream &stream);
+			~Reader() = default;
+
+			// false at the end of the stream or on malformed input, check failed()
+			auto next(viriformat::Game &game) -> bool;
+
+			[[nodiscard]] inline auto failed() const
+			{
+				return m_failed;
+			}
+
+			[[nodiscard]] inline auto blocks() const
+			{
+				return m_blocks;
+			}
+
+			[[nodiscard]] inline auto compressedBlocks() const
+			{
+				return m_compressedBlocks;
+			}
+
+		private:
+			std::istream &m_stream;
+
+			std::vector<u8> m_block{};
+			usize m_offset{};
+
+			Position m_pos{};
+
+			bool m_failed{false};
+
+			usize m_blocks{};
+			usize m_compressedBlocks{};
+
+			auto readBlock() -> bool;
+		};
+
+		// round trips every game in a viriformat file through chainformat
+		// and checks that the decoded games are identical
+		auto verify(const std::string &viriformatPath) -> i32;
+	}
+
+	class Chainformat
+	{
+	public:
+		Chainformat();
+		~Chainformat();
+
+		Chainformat(const Chainformat &) = delete;
+		auto operator=(const Chainformat &) -> Chainformat & = delete;
+
+		static constexpr auto Extension = "cf";
+
+		auto start(const Position &initialPosition) -> void;
+		auto push(bool filtered, Move move, Score score) -> void;
+		auto writeAllWithOutcome(std::ostream &stream, Outcome outcome) -> usize;
+
+		// writes out any games still buffered as a final, possibly short, block
+		auto finish(std::ostream &stream) -> void;
+
+		[[nodiscard]] inline auto hasBufferedGames() const
+		{
+			return !m_block.empty();
+		}
+
+	private:
+		static constexpr usize TargetBlockSize = 1024 * 1024;
+		// blocks are compressed on the worker threads, so keep this cheap
+		static constexpr i32 CompressionLevel = 3;
+
+		marlinformat::PackedBoard m_initial{};
+		Position m_curr;
+
+		// [index, bits]
+		std::vector<std::pair<u32, u32>> m_moveIndices{};
+		std::vector<i16> m_scores{};
+
+		std::vector<u8> m_block{};
+		std::vector<u8> m_compressed{};
+
+		ZSTD_CCtx *m_cctx;
+
+		auto writeBlock(std::ostream &stream) -> void;
+	};
+
+	static_assert(OutputFormat<Chainformat>);
+}
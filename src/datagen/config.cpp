@@ -0,0 +1,151 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <variant>
+#include <type_traits>
+
+#include "../util/parse.h"
+
+namespace oranj::datagen
+{
+	namespace
+	{
+		struct Knob
+		{
+			const char *name;
+			std::variant<usize Knobs::*, Score Knobs::*, u32 Knobs::*> member;
+			i64 min;
+		};
+
+		const std::array KnobTable{
+			Knob{"soft-nodes", &Knobs::softNodes, 1},
+			Knob{"hard-nodes", &Knobs::hardNodes, 1},
+			Knob{"verification-hard-nodes", &Knobs::verificationHardNodes, 1},
+			Knob{"verification-score-limit", &Knobs::verificationScoreLimit, 0},
+			Knob{"win-adj-min-score", &Knobs::winAdjMinScore, 1},
+			Knob{"draw-adj-max-score", &Knobs::drawAdjMaxScore, 0},
+			Knob{"win-adj-max-plies", &Knobs::winAdjMaxPlies, 1},
+			Knob{"draw-adj-max-plies", &Knobs::drawAdjMaxPlies, 1},
+		};
+	}
+
+	auto setKnob(Knobs &knobs, const std::string &name, const std::string &value) -> bool
+	{
+		for (const auto &knob : KnobTable)
+		{
+			if (name != knob.name)
+				continue;
+
+			return std::visit([&]<typename T>(T Knobs::*member)
+			{
+				T parsed{};
+
+				bool valid;
+				if constexpr (std::is_same_v<T, usize>)
+					valid = util::tryParseSize(parsed, value);
+				else if constexpr (std::is_same_v<T, Score>)
+					valid = util::tryParseI32(parsed, value);
+				else valid = util::tryParseU32(parsed, value);
+
+				if (!valid)
+					return false;
+
+				if (static_cast<i64>(parsed) < knob.min)
+				{
+					std::cerr << knob.name << " must be at least " << knob.min << std::endl;
+					return false;
+				}
+
+				knobs.*member = parsed;
+				return true;
+			}, knob.member);
+		}
+
+		return false;
+	}
+
+	auto validateKnobs(const Knobs &knobs) -> bool
+	{
+		bool valid = true;
+
+		if (knobs.softNodes > knobs.hardNodes)
+		{
+			std::cerr << "soft-nodes (" << knobs.softNodes
+				<< ") must not exceed hard-nodes (" << knobs.hardNodes << ")" << std::endl;
+			valid = false;
+		}
+
+		if (knobs.drawAdjMaxScore >= knobs.winAdjMinScore)
+		{
+			std::cerr << "draw-adj-max-score (" << knobs.drawAdjMaxScore
+				<< ") must be below win-adj-min-score (" << knobs.winAdjMinScore << ")" << std::endl;
+			valid = false;
+		}
+
+		return valid;
+	}
+
+	auto writeKnobs(std::ostream &stream, const Knobs &knobs) -> void
+	{
+		for (const auto &knob : KnobTable)
+		{
+			stream << knob.name << ' ';
+			std::visit([&](auto member) { stream << knobs.*member; }, knob.member);
+			stream << '\n';
+		}
+	}
+
+	auto loadKnobs(const std::string &path, Knobs &knobs) -> bool
+	{
+		std::ifstream stream{path};
+
+		if (!stream)
+		{
+			std::cerr << "failed to open " << path << std::endl;
+			return false;
+		}
+
+		for (std::string line{}; std::getline(stream, line);)
+		{
+			if (const auto comment = line.find('#'); comment != std::string::npos)
+				line.resize(comment);
+
+			std::istringstream lineStream{line};
+
+			std::string name{};
+			std::string value{};
+
+			if (!(lineStream >> name))
+				continue;
+
+			if (!(lineStream >> value) || !setKnob(knobs, name, value))
+			{
+				std::cerr << "invalid datagen config line: " << line << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
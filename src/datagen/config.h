@@ -0,0 +1,95 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <string>
+#include <limits>
+#include <optional>
+#include <ostream>
+
+#include "../core.h"
+
+namespace oranj::datagen
+{
+	constexpr auto UnlimitedGames = std::numeric_limits<u32>::max();
+
+	// datagen searches are tiny, so a small tt per thread is enough
+	constexpr usize DefaultDatagenTtSizeMib = 16;
+
+	// per thread, if a dry run is not given a game limit
+	constexpr u32 DefaultDryRunGames = 32;
+
+	// search limits and adjudication thresholds, settable by
+	// name from a config file, the command line or a manifest
+	struct Knobs
+	{
+		usize softNodes{5000};
+		usize hardNodes{8388608};
+
+		// opening verification search
+		usize verificationHardNodes{25165814};
+		Score verificationScoreLimit{1000};
+
+		Score winAdjMinScore{2500};
+		Score drawAdjMaxScore{10};
+
+		u32 winAdjMaxPlies{5};
+		u32 drawAdjMaxPlies{10};
+	};
+
+	struct Config
+	{
+		std::string format{};
+		bool dfrc{false};
+		std::string output{};
+
+		u32 threads{1};
+		// per thread
+		u32 games{UnlimitedGames};
+
+		usize ttSizeMib{DefaultDatagenTtSizeMib};
+		bool directIo{false};
+
+		// generated if not given
+		std::optional<u64> seed{};
+
+		// epd/fen file to take starting positions from, instead of random walks
+		std::string openings{};
+		// random plies played from each book position
+		u32 randomPlies{0};
+
+		Knobs knobs{};
+
+		// generate without writing anything, and report throughput
+		bool dryRun{false};
+	};
+
+	// false if there is no knob with that name, or the value is
+	// unparseable or below that knob's minimum (reported to stderr)
+	auto setKnob(Knobs &knobs, const std::string &name, const std::string &value) -> bool;
+	// checks constraints between knobs, which cannot be enforced
+	// one knob at a time since they may be set in any order
+	auto validateKnobs(const Knobs &knobs) -> bool;
+	auto writeKnobs(std::ostream &stream, const Knobs &knobs) -> void;
+
+	// one "name value" pair per line, # starts a comment
+	auto loadKnobs(const std::string &path, Knobs &knobs) -> bool;
+}
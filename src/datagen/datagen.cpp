@@ -18,13 +18,15 @@
 
 #include "datagen.h"
 
-#include <fstream>
 #include <thread>
 #include <chrono>
 #include <atomic>
 #include <filesystem>
 #include <optional>
 #include <cassert>
+#include <mutex>
+#include <condition_variable>
+#include <span>
 
 #include "../limit/limit.h"
 #include "../search.h"
@@ -34,9 +36,16 @@
 #include "../util/timer.h"
 #include "format.h"
 #include "viriformat.h"
+#include "chainformat.h"
 #include "marlinformat.h"
 #include "fen.h"
+#include "writer.h"
+#include "manifest.h"
+#include "openings.h"
+#include "stats.h"
+#include "game.h"
 #include "../util/ctrlc.h"
+#include "../util/memory_usage.h"
 
 // abandon hope all ye who enter here
 // my search was not written with this in mind
@@ -59,79 +68,27 @@ namespace oranj::datagen
 			});
 		}
 
-		class DatagenNodeLimiter final : public limit::ISearchLimiter
-		{
-		public:
-			explicit DatagenNodeLimiter(u32 threadId) : m_threadId{threadId} {}
-			~DatagenNodeLimiter() final = default;
-
-			[[nodiscard]] auto stop(const search::SearchData &data, bool allowSoftTimeout) -> bool final
-			{
-				if (data.nodes >= m_hardNodeLimit)
-				{
-					std::cout << "thread " << m_threadId << ": stopping search after "
-						<< data.nodes << " nodes (limit: " << m_hardNodeLimit << ")" << std::endl;
-					return true;
-				}
-
-				return allowSoftTimeout && data.nodes >= m_softNodeLimit;
-			}
-
-			[[nodiscard]] auto stopped() const -> bool final
-			{
-				// doesn't matter
-				return false;
-			}
-
-			inline auto setSoftNodeLimit(usize nodes)
-			{
-				m_softNodeLimit = nodes;
-			}
-
-			inline auto setHardNodeLimit(usize nodes)
-			{
-				m_hardNodeLimit = nodes;
-			}
-
-		private:
-			u32 m_threadId;
-			usize m_softNodeLimit{};
-			usize m_hardNodeLimit{};
-		};
-
-		constexpr usize VerificationHardNodeLimit = 25165814;
-
-		constexpr usize DatagenSoftNodeLimit = 5000;
-		constexpr usize DatagenHardNodeLimit = 8388608;
-
-		constexpr Score VerificationScoreLimit = 1000;
-
-		constexpr Score WinAdjMinScore = 2500;
-		constexpr Score DrawAdjMaxScore = 10;
-
-		constexpr u32 WinAdjMaxPlies = 5;
-		constexpr u32 DrawAdjMaxPlies = 10;
-
 		constexpr i32 ReportInterval = 1024;
+		// seconds
+		constexpr f64 SummaryInterval = 60.0;
 
 		template <OutputFormat Format>
-		auto runThread(u32 id, bool dfrc, u32 games, u64 seed, const std::filesystem::path &outDir)
+		auto runThread(u32 id, const Config &config, const OpeningBook *book,
+			const Checkpoint &start, WriterChannel &channel, ThreadStats &stats)
 		{
-			const auto outFile = outDir / (std::to_string(id) + "." + Format::Extension);
-			std::ofstream out{outFile, std::ios::binary | std::ios::app};
+			const auto games = config.games;
+			const auto &knobs = config.knobs;
 
-			if (!out)
-			{
-				std::cerr << "failed to open output file " << outFile << std::endl;
-				return;
-			}
+			auto &out = channel.stream();
 
-			util::rng::Jsf64Rng rng{seed};
+			util::rng::Jsf64Rng rng{start.rng};
 
 			auto limiterPtr = std::make_unique<DatagenNodeLimiter>(id);
 			auto &limiter = *limiterPtr;
 
-			search::Searcher searcher{};
+			// all searching happens on this thread through runDatagenSearch,
+			// so the searcher does not need a thread pool of its own
+			search::Searcher searcher{config.ttSizeMib, search::NoSearchThreads};
 			searcher.setLimiter(std::move(limiterPtr));
 
 			auto thread = std::make_unique<search::ThreadData>();
@@ -141,59 +98,55 @@ namespace oranj::datagen
 			{
 				searcher.newGame();
 
+				// the searcher has no threads of its own, so newGame() does not reset this one
+				thread->resetForNewGame();
 				thread->search = search::SearchData{};
-
-				thread->history.clear();
-				thread->correctionHistory.clear();
 			};
 
 			Format output{};
 
-			const auto startTime = Instant::now();
-
-			usize totalPositions{};
+			const auto push = [&](bool filtered, Move move, Score score)
+			{
+				output.push(filtered, move, score);
+				stats.add(Counter::Moves);
+			};
 
-			for (i32 game = 0; game < games && !s_stop.load(std::memory_order::seq_cst); ++game)
+			// times whatever happens until the next call
+			auto phaseStart = Instant::now();
+			const auto endPhase = [&](Phase phase)
 			{
-				resetSearch();
+				const auto now = Instant::now();
+				stats.addTime(phase, now.elapsedSince(phaseStart));
+				phaseStart = now;
+			};
 
-				if (dfrc)
-				{
-					const auto dfrcIndex = rng.nextU32(960 * 960);
-					thread->pos.resetFromDfrcIndex(dfrcIndex);
-				}
-				else thread->pos.resetToStarting();
+			const auto startTime = Instant::now();
 
-				const auto moveCount = 8 + (rng.nextU32() >> 31);
+			usize totalPositions = start.positions;
 
-				bool legalFound = false;
+			// games do not affect each other, so a resumed thread only needs its rng state back
+			i64 game = static_cast<i64>(start.games);
 
-				for (i32 i = 0; i < moveCount; ++i)
-				{
-					ScoredMoveList moves{};
-					generateAll(moves, thread->pos);
+			for (; game < games && !s_stop.load(std::memory_order::seq_cst); ++game)
+			{
+				phaseStart = Instant::now();
 
-					std::shuffle(moves.begin(), moves.end(), rng);
+				resetSearch();
 
-					legalFound = false;
+				const auto opening = playOpening(id, config, book, rng, thread->pos);
 
-					for (const auto [move, score] : moves)
-					{
-						if (thread->pos.isLegal(move))
-						{
-							thread->pos.applyMoveUnchecked<false>(move, nullptr);
-							legalFound = true;
-							break;
-						}
-					}
-
-					if (!legalFound)
-						break;
+				if (opening.status == OpeningStatus::NoBookPositions)
+				{
+					std::cerr << "thread " << id << ": no valid positions found in opening book" << std::endl;
+					break;
 				}
 
-				if (!legalFound)
+				endPhase(Phase::Walk);
+
+				if (opening.status == OpeningStatus::Rejected)
 				{
 					// this game was useless, don't count it
+					stats.add(Counter::WalkRejects);
 					--game;
 					continue;
 				}
@@ -203,29 +156,34 @@ namespace oranj::datagen
 				thread->pos.clearStateHistory();
 				thread->nnueState.reset(thread->pos.bbs(), thread->pos.kings());
 
-				thread->maxDepth = 10;
-				limiter.setSoftNodeLimit(std::numeric_limits<usize>::max());
-				limiter.setHardNodeLimit(VerificationHardNodeLimit);
+				if (opening.verify)
+				{
+					thread->maxDepth = 10;
+					limiter.setSoftNodeLimit(std::numeric_limits<usize>::max());
+					limiter.setHardNodeLimit(knobs.verificationHardNodes);
 
-				const auto [firstScore, normFirstScore] = searcher.runDatagenSearch(*thread);
+					const auto [firstScore, normFirstScore] = searcher.runDatagenSearch(*thread);
 
-				thread->maxDepth = MaxDepth;
-				limiter.setSoftNodeLimit(DatagenSoftNodeLimit);
-				limiter.setHardNodeLimit(DatagenHardNodeLimit);
+					endPhase(Phase::Verification);
 
-				if (std::abs(normFirstScore) > VerificationScoreLimit)
-				{
-					--game;
-					continue;
+					if (std::abs(normFirstScore) > knobs.verificationScoreLimit)
+					{
+						stats.add(Counter::VerificationRejects);
+						--game;
+						continue;
+					}
 				}
 
+				thread->maxDepth = MaxDepth;
+				limiter.setSoftNodeLimit(knobs.softNodes);
+				limiter.setHardNodeLimit(knobs.hardNodes);
+
 				resetSearch();
 
-				u32 winPlies{};
-				u32 lossPlies{};
-				u32 drawPlies{};
+				Adjudicator adjudicator{knobs};
 
 				std::optional<Outcome> outcome{};
+				auto ending = Ending::NoLegalMoves;
 
 				while (true)
 				{
@@ -236,78 +194,49 @@ namespace oranj::datagen
 
 					if (!move)
 					{
-						outcome = thread->pos.toMove() == Color::Black
-							? Outcome::WhiteWin
-							: Outcome::WhiteLoss;
+						outcome = noLegalMovesResult(thread->pos).outcome;
 						break;
 					}
 
 					assert(thread->pos.boards().pieceAt(move.src()) != Piece::None);
 
-					if (std::abs(score) > ScoreWin)
-						outcome = score > 0 ? Outcome::WhiteWin : Outcome::WhiteLoss;
-					else
+					if (const auto result = adjudicator.update(score, normScore))
 					{
-						if (normScore > WinAdjMinScore)
-						{
-							++winPlies;
-							lossPlies = 0;
-							drawPlies = 0;
-						}
-						else if (normScore < -WinAdjMinScore)
-						{
-							winPlies = 0;
-							++lossPlies;
-							drawPlies = 0;
-						}
-						else if (std::abs(normScore) < DrawAdjMaxScore)
-						{
-							winPlies = 0;
-							lossPlies = 0;
-							++drawPlies;
-						}
-						else
-						{
-							winPlies = 0;
-							lossPlies = 0;
-							drawPlies = 0;
-						}
-
-						if (winPlies >= WinAdjMaxPlies)
-							outcome = Outcome::WhiteWin;
-						else if (lossPlies >= WinAdjMaxPlies)
-							outcome = Outcome::WhiteLoss;
-						else if (drawPlies >= DrawAdjMaxPlies)
-							outcome = Outcome::Draw;
+						outcome = result->outcome;
+						ending = result->ending;
 					}
 
-					const bool filtered = thread->pos.isCheck() || thread->pos.isNoisy(move);
+					auto filterReason = Counter::Count;
+
+					if (thread->pos.isCheck())
+						filterReason = Counter::FilteredCheck;
+					else if (thread->pos.isNoisy(move))
+						filterReason = Counter::FilteredNoisy;
+
+					const bool filtered = filterReason != Counter::Count;
 
 					thread->pos.applyMoveUnchecked<true, false>(move, &thread->nnueState);
 
 					assert(eval::staticEvalOnce(thread->pos) == eval::staticEval(thread->pos, thread->nnueState));
 
-					if (thread->pos.isBareKingWin())
-					{
-						if (thread->pos.toMove() == Color::Black)
-						{
-							outcome = Outcome::WhiteLoss;
-							output.push(true, move, ScoreMate);
-						}
-						else
-						{
-							outcome = Outcome::WhiteWin;
-							output.push(true, move, -ScoreMate);
-						}
-					}
-					else if (thread->pos.isDrawn(false))
+					if (const auto result = terminalResult(thread->pos))
 					{
-						outcome = Outcome::Draw;
-						output.push(true, move, 0);
+						outcome = result->outcome;
+						ending = result->ending;
+
+						stats.add(Counter::FilteredTerminal);
+
+						if (ending == Ending::BareKing)
+							push(true, move, *outcome == Outcome::WhiteLoss ? ScoreMate : -ScoreMate);
+						else push(true, move, 0);
+
 						break;
 					}
 
-					output.push(filtered, move, score);
+					if (filtered)
+						stats.add(filterReason);
+
+					push(filtered, move, score);
 
 					if (outcome)
 						break;
@@ -315,9 +244,34 @@ namespace oranj::datagen
 
 				assert(outcome.has_value());
 
+				endPhase(Phase::Search);
+
+				stats.addEnding(ending);
+
 				const auto positions = output.writeAllWithOutcome(out, *outcome);
 				totalPositions += positions;
 
+				stats.add(Counter::Games);
+				stats.add(Counter::Positions, positions);
+
+				// formats that hold games back can only be resumed from between their blocks
+				bool buffered = false;
+				if constexpr (requires { output.hasBufferedGames(); })
+					buffered = output.hasBufferedGames();
+
+				if (!buffered)
+					channel.checkpoint({
+						.games = static_cast<u64>(game + 1),
+						.positions = totalPositions,
+						.rng = rng.state(),
+					});
+
+				endPhase(Phase::Serialisation);
+
+				channel.commit();
+
+				endPhase(Phase::Io);
+
 				if (game == games - 1
 					|| ((game + 1) % ReportInterval) == 0
 					|| s_stop.load(std::memory_order::seq_cst))
@@ -325,71 +279,239 @@ namespace oranj::datagen
 					const auto time = startTime.elapsed();
 					std::cout << "thread " << id << ": wrote " << totalPositions << " positions from "
 						<< (game + 1) << " games in " << time << " sec ("
-						<< (static_cast<f64>(totalPositions) / time) << " positions/sec)" << std::endl;
+						<< (static_cast<f64>(totalPositions - start.positions) / time) << " positions/sec, "
+						<< (static_cast<f64>(channel.bytesWritten()) / (1024.0 * 1024.0) / time) << " MiB/sec)"
+						<< std::endl;
 				}
 			}
+
+			// block-based formats buffer games in memory
+			if constexpr (requires { output.finish(out); })
+			{
+				output.finish(out);
+				channel.checkpoint({
+					.games = static_cast<u64>(game),
+					.positions = totalPositions,
+					.rng = rng.state(),
+				});
+			}
+
+			channel.close();
 		}
 
-		template auto runThread<Marlinformat>(u32 id, bool dfrc,
-			u32 games, u64 seed, const std::filesystem::path &outDir);
-		template auto runThread<Viriformat>(u32 id, bool dfrc,
-			u32 games, u64 seed, const std::filesystem::path &outDir);
-		template auto runThread<Fen>(u32 id, bool dfrc,
-			u32 games, u64 seed, const std::filesystem::path &outDir);
+		template auto runThread<Marlinformat>(u32 id, const Config &config,
+			const OpeningBook *book, const Checkpoint &start, WriterChannel &channel, ThreadStats &stats);
+		template auto runThread<Viriformat>(u32 id, const Config &config,
+			const OpeningBook *book, const Checkpoint &start, WriterChannel &channel, ThreadStats &stats);
+		template auto runThread<Fen>(u32 id, const Config &config,
+			const OpeningBook *book, const Checkpoint &start, WriterChannel &channel, ThreadStats &stats);
+		template auto runThread<Chainformat>(u32 id, const Config &config,
+			const OpeningBook *book, const Checkpoint &start, WriterChannel &channel, ThreadStats &stats);
 	}
 
-	auto run(const std::function<void()> &printUsage, const std::string &format,
-		bool dfrc, const std::string &output, i32 threads, u32 games) -> i32
+	namespace
 	{
-		std::function<decltype(runThread<Marlinformat>)> threadFunc{};
-
-		if (format == "marlinformat")
-			threadFunc = runThread<Marlinformat>;
-		else if (format == "viriformat")
-			threadFunc = runThread<Viriformat>;
-		else if (format == "fen")
-			threadFunc = runThread<Fen>;
-		else
+		auto generate(const std::function<void()> &printUsage,
+			const Config &config, Manifest manifest, bool resuming) -> i32
 		{
-			std::cerr << "invalid output format " << format << std::endl;
-			printUsage();
-			return 1;
-		}
+			std::function<decltype(runThread<Marlinformat>)> threadFunc{};
+			std::string extension{};
 
-		opts::mutableOpts().chess960 = dfrc;
+			if (config.format == "marlinformat")
+			{
+				threadFunc = runThread<Marlinformat>;
+				extension = Marlinformat::Extension;
+			}
+			else if (config.format == "viriformat")
+			{
+				threadFunc = runThread<Viriformat>;
+				extension = Viriformat::Extension;
+			}
+			else if (config.format == "fen")
+			{
+				threadFunc = runThread<Fen>;
+				extension = Fen::Extension;
+			}
+			else if (config.format == "chainformat")
+			{
+				threadFunc = runThread<Chainformat>;
+				extension = Chainformat::Extension;
+			}
+			else
+			{
+				std::cerr << "invalid output format " << config.format << std::endl;
+				printUsage();
+				return 1;
+			}
 
-		const auto baseSeed = util::rng::generateSingleSeed();
-		std::cout << "base seed: " << baseSeed << std::endl;
+			if (!validateKnobs(config.knobs))
+				return 1;
 
-		util::rng::SeedGenerator seedGenerator{baseSeed};
+			opts::mutableOpts().chess960 = config.dfrc;
 
-		const std::filesystem::path outDir{output};
+			std::cout << "base seed: " << manifest.seed << std::endl;
 
-		initCtrlCHandler();
+			std::unique_ptr<OpeningBook> book{};
 
-		std::vector<std::thread> theThreads{};
-		theThreads.reserve(threads);
+			if (!config.openings.empty())
+			{
+				book = OpeningBook::open(config.openings, config.threads);
 
-		if (games == UnlimitedGames)
-			std::cout << "generating on " << threads << " threads" << std::endl;
-		else std::cout << "generating " << games << " games each on " << threads << " threads" << std::endl;
+				if (!book)
+					return 1;
 
-		for (u32 i = 0; i < threads; ++i)
-		{
-			const auto seed = seedGenerator.nextSeed();
-			theThreads.emplace_back([&, i, seed]()
+				std::cout << "using openings from " << config.openings << " with "
+					<< config.randomPlies << " random plies" << std::endl;
+			}
+
+			const std::filesystem::path outDir{config.output};
+
+			std::mutex manifestMutex{};
+
+			AsyncWriter writer{config.directIo, [&](std::span<const Checkpoint> checkpoints)
 			{
-				threadFunc(i, dfrc, games, seed, outDir);
-			});
+				if (config.dryRun)
+					return;
+
+				const std::unique_lock lock{manifestMutex};
+
+				manifest.threads.assign(checkpoints.begin(), checkpoints.end());
+				writeManifest(outDir, manifest);
+			}, []
+			{
+				s_stop.store(true, std::memory_order::seq_cst);
+			}};
+
+			std::vector<WriterChannel *> channels{};
+			channels.reserve(config.threads);
+
+			for (u32 i = 0; i < config.threads; ++i)
+			{
+				auto *channel = config.dryRun
+					? writer.openDiscarding(manifest.threads[i])
+					: writer.open(outDir / (std::to_string(i) + "." + extension), manifest.threads[i], resuming);
+
+				if (!channel)
+					return 1;
+
+				channels.push_back(channel);
+			}
+
+			initCtrlCHandler();
+
+			writer.start();
+
+			std::vector<std::thread> theThreads{};
+			theThreads.reserve(config.threads);
+
+			if (config.games == UnlimitedGames)
+				std::cout << "generating on " << config.threads << " threads" << std::endl;
+			else std::cout << "generating " << config.games << " games each on "
+				<< config.threads << " threads" << std::endl;
+
+			std::cout << "using a " << config.ttSizeMib << " MiB tt per thread" << std::endl;
+
+			std::vector<ThreadStats> stats(config.threads);
+
+			const auto startTime = Instant::now();
+
+			std::mutex finishedMutex{};
+			std::condition_variable finishedSignal{};
+			u32 finishedThreads{};
+
+			for (u32 i = 0; i < config.threads; ++i)
+			{
+				if (resuming)
+					std::cout << "thread " << i << ": resuming after " << manifest.threads[i].games
+						<< " games" << std::endl;
+
+				theThreads.emplace_back([&, i, start = manifest.threads[i]]()
+				{
+					threadFunc(i, config, book.get(), start, *channels[i], stats[i]);
+
+					{
+						const std::unique_lock lock{finishedMutex};
+						++finishedThreads;
+					}
+
+					finishedSignal.notify_one();
+				});
+			}
+
+			{
+				std::unique_lock lock{finishedMutex};
+
+				while (!finishedSignal.wait_for(lock, std::chrono::duration<f64>(SummaryInterval),
+					[&] { return finishedThreads == config.threads; }))
+				{
+					printSummary(stats, startTime.elapsed(), writer.busyTime());
+				}
+			}
+
+			for (auto &thread : theThreads)
+			{
+				thread.join();
+			}
+
+			const auto time = startTime.elapsed();
+
+			const bool written = writer.finish();
+
+			printSummary(stats, time, writer.busyTime());
+
+			if (const auto peakRss = util::peakRssBytes())
+				std::cout << "peak rss: " << (static_cast<f64>(*peakRss) / (1024.0 * 1024.0)) << " MiB" << std::endl;
+
+			if (!written)
+			{
+				std::cerr << "datagen output failed, resume the run to continue from the last checkpoint" << std::endl;
+				return 1;
+			}
+
+			std::cout << "done" << std::endl;
+
+			return 0;
 		}
+	}
+
+	auto run(const std::function<void()> &printUsage, const Config &config) -> i32
+	{
+		const std::filesystem::path outDir{config.output};
 
-		for (auto &thread : theThreads)
+		if (!config.dryRun && std::filesystem::exists(outDir / ManifestFilename))
 		{
-			thread.join();
+			std::cerr << "output directory already contains a run, use --resume to continue it" << std::endl;
+			return 1;
 		}
 
-		std::cout << "done" << std::endl;
+		Manifest manifest{
+			.config = config,
+			.seed = config.seed.value_or(util::rng::generateSingleSeed()),
+		};
+
+		util::rng::SeedGenerator seedGenerator{manifest.seed};
+
+		for (u32 i = 0; i < config.threads; ++i)
+		{
+			const util::rng::Jsf64Rng rng{seedGenerator.nextSeed()};
+			manifest.threads.push_back({.rng = rng.state()});
+		}
+
+		return generate(printUsage, config, std::move(manifest), false);
+	}
+
+	auto resume(const std::string &dir, bool directIo) -> i32
+	{
+		auto manifest = readManifest(dir);
+
+		if (!manifest)
+			return 1;
+
+		auto config = manifest->config;
+		config.directIo = directIo;
+
+		const auto printUsage = [] {};
 
-		return 0;
+		return generate(printUsage, config, std::move(*manifest), true);
 	}
 }
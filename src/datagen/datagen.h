@@ -21,13 +21,14 @@
 #include "../types.h"
 
 #include <string>
-#include <limits>
 #include <functional>
 
+#include "config.h"
+
 namespace oranj::datagen
 {
-	constexpr auto UnlimitedGames = std::numeric_limits<u32>::max();
+	auto run(const std::function<void()> &printUsage, const Config &config) -> i32;
 
-	auto run(const std::function<void()> &printUsage, const std::string &format,
-		bool dfrc, const std::string &output, i32 threads, u32 games = UnlimitedGames) -> i32;
+	// continues the run in dir from its manifest
+	auto resume(const std::string &dir, bool directIo) -> i32;
 }
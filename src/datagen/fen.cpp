@@ -18,48 +18,67 @@
 
 #include "fen.h"
 
+#include <array>
+#include <charconv>
+#include <string_view>
+
 namespace oranj::datagen
 {
 	Fen::Fen()
 	{
-		m_positions.reserve(256);
+		m_buffer.reserve(256 * 64);
+		m_lineEnds.reserve(256);
 	}
 
 	auto Fen::start(const Position &initialPosition) -> void
 	{
-		m_positions.clear();
+		m_buffer.clear();
+		m_lineEnds.clear();
+
 		m_curr.copyStateFrom(initialPosition);
 	}
 
 	auto Fen::push(bool filtered, Move move, Score score) -> void
 	{
 		if (!filtered)
-			m_positions.push_back(m_curr.toFen() + " | " + std::to_string(score));
+		{
+			m_curr.writeFen(m_buffer);
+			m_buffer += " | ";
+
+			std::array<char, 16> scoreStr{};
+			const auto [end, _ec] = std::to_chars(scoreStr.data(), scoreStr.data() + scoreStr.size(), score);
+			m_buffer.append(scoreStr.data(), end);
+
+			m_lineEnds.push_back(m_buffer.size());
+		}
+
 		m_curr.applyMoveUnchecked<false, false>(move, nullptr);
 	}
 
 	auto Fen::writeAllWithOutcome(std::ostream &stream, Outcome outcome) -> usize
 	{
-		for (auto &fen : m_positions)
+		const std::string_view suffix = [&]
 		{
-			stream << fen << " | ";
-
 			switch (outcome)
 			{
-			case Outcome::WhiteLoss:
-				stream << "0.0";
-				break;
-			case Outcome::Draw:
-				stream << "0.5";
-				break;
-			case Outcome::WhiteWin:
-				stream << "1.0";
-				break;
+			case Outcome::WhiteLoss: return " | 0.0\n";
+			case Outcome::Draw: return " | 0.5\n";
+			case Outcome::WhiteWin: return " | 1.0\n";
 			}
 
-			stream << '\n';
+			__builtin_unreachable();
+		}();
+
+		usize begin = 0;
+
+		for (const auto end : m_lineEnds)
+		{
+			stream.write(m_buffer.data() + begin, static_cast<std::streamsize>(end - begin));
+			stream.write(suffix.data(), static_cast<std::streamsize>(suffix.size()));
+
+			begin = end;
 		}
 
-		return m_positions.size();
+		return m_lineEnds.size();
 	}
 }
@@ -20,6 +20,7 @@
 
 #include "../types.h"
 
+#include <string>
 #include <vector>
 
 #include "format.h"
@@ -41,7 +42,9 @@ namespace oranj::datagen
 		auto writeAllWithOutcome(std::ostream &stream, Outcome outcome) -> usize;
 
 	private:
-		std::vector<std::string> m_positions{};
+		// every position's line, without outcomes, in one buffer
+		std::string m_buffer{};
+		std::vector<usize> m_lineEnds{};
 		Position m_curr;
 	};
 
@@ -0,0 +1,136 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "game.h"
+
+#include <algorithm>
+
+#include "../movegen.h"
+
+namespace oranj::datagen
+{
+	auto playOpening(u32 id, const Config &config, const OpeningBook *book,
+		util::rng::Jsf64Rng &rng, Position &pos) -> Opening
+	{
+		if (book)
+		{
+			if (!book->pick(id, rng, pos))
+				return {OpeningStatus::NoBookPositions, false};
+		}
+		else if (config.dfrc)
+		{
+			const auto dfrcIndex = rng.nextU32(960 * 960);
+			pos.resetFromDfrcIndex(dfrcIndex);
+		}
+		else pos.resetToStarting();
+
+		const auto moveCount = book ? config.randomPlies : 8 + (rng.nextU32() >> 31);
+
+		for (i32 i = 0; i < moveCount; ++i)
+		{
+			ScoredMoveList moves{};
+			generateAll(moves, pos);
+
+			std::shuffle(moves.begin(), moves.end(), rng);
+
+			bool legalFound = false;
+
+			for (const auto [move, score] : moves)
+			{
+				if (pos.isLegal(move))
+				{
+					pos.applyMoveUnchecked<false>(move, nullptr);
+					legalFound = true;
+					break;
+				}
+			}
+
+			if (!legalFound)
+				return {OpeningStatus::Rejected, false};
+		}
+
+		// book positions are trusted to be reasonably balanced,
+		// unless they have been randomised further
+		return {OpeningStatus::Ok, !book || moveCount > 0};
+	}
+
+	auto terminalResult(const Position &pos) -> std::optional<GameResult>
+	{
+		if (pos.isBareKingWin())
+			return GameResult{
+				.outcome = pos.toMove() == Color::Black ? Outcome::WhiteLoss : Outcome::WhiteWin,
+				.ending = Ending::BareKing,
+			};
+
+		if (pos.isDrawn(false))
+			return GameResult{
+				.outcome = Outcome::Draw,
+				.ending = Ending::DrawRule,
+			};
+
+		return {};
+	}
+
+	auto Adjudicator::update(Score score, Score normScore) -> std::optional<GameResult>
+	{
+		if (std::abs(score) > ScoreWin)
+			return GameResult{
+				.outcome = score > 0 ? Outcome::WhiteWin : Outcome::WhiteLoss,
+				.ending = Ending::MateScore,
+			};
+
+		if (normScore > m_knobs.winAdjMinScore)
+		{
+			++m_winPlies;
+			m_lossPlies = 0;
+			m_drawPlies = 0;
+		}
+		else if (normScore < -m_knobs.winAdjMinScore)
+		{
+			m_winPlies = 0;
+			++m_lossPlies;
+			m_drawPlies = 0;
+		}
+		else if (std::abs(normScore) < m_knobs.drawAdjMaxScore)
+		{
+			m_winPlies = 0;
+			m_lossPlies = 0;
+			++m_drawPlies;
+		}
+		else
+		{
+			m_winPlies = 0;
+			m_lossPlies = 0;
+			m_drawPlies = 0;
+		}
+
+		if (m_winPlies >= m_knobs.winAdjMaxPlies || m_lossPlies >= m_knobs.winAdjMaxPlies)
+			return GameResult{
+				.outcome = m_winPlies > 0 ? Outcome::WhiteWin : Outcome::WhiteLoss,
+				.ending = Ending::WinAdjudication,
+			};
+
+		if (m_drawPlies >= m_knobs.drawAdjMaxPlies)
+			return GameResult{
+				.outcome = Outcome::Draw,
+				.ending = Ending::DrawAdjudication,
+			};
+
+		return {};
+	}
+}
@@ -0,0 +1,133 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <iostream>
+#include <optional>
+
+#include "common.h"
+#include "config.h"
+#include "openings.h"
+#include "stats.h"
+#include "../limit/limit.h"
+#include "../position/position.h"
+#include "../search.h"
+#include "../util/rng.h"
+
+// the parts of a datagen game shared with selfplay
+namespace oranj::datagen
+{
+	class DatagenNodeLimiter final : public limit::ISearchLimiter
+	{
+	public:
+		explicit DatagenNodeLimiter(u32 threadId) : m_threadId{threadId} {}
+		~DatagenNodeLimiter() final = default;
+
+		[[nodiscard]] auto stop(const search::SearchData &data, bool allowSoftTimeout) -> bool final
+		{
+			if (data.nodes >= m_hardNodeLimit)
+			{
+				std::cout << "thread " << m_threadId << ": stopping search after "
+					<< data.nodes << " nodes (limit: " << m_hardNodeLimit << ")" << std::endl;
+				return true;
+			}
+
+			return allowSoftTimeout && data.nodes >= m_softNodeLimit;
+		}
+
+		[[nodiscard]] auto stopped() const -> bool final
+		{
+			// doesn't matter
+			return false;
+		}
+
+		inline auto setSoftNodeLimit(usize nodes)
+		{
+			m_softNodeLimit = nodes;
+		}
+
+		inline auto setHardNodeLimit(usize nodes)
+		{
+			m_hardNodeLimit = nodes;
+		}
+
+	private:
+		u32 m_threadId;
+		usize m_softNodeLimit{};
+		usize m_hardNodeLimit{};
+	};
+
+	enum class OpeningStatus
+	{
+		Ok,
+		// the random walk ran out of legal moves, try again
+		Rejected,
+		// the book has no valid positions, give up
+		NoBookPositions,
+	};
+
+	struct Opening
+	{
+		OpeningStatus status;
+		// whether the opening needs a verification search to check it is balanced
+		bool verify;
+	};
+
+	// Sets pos to a book position, standard or dfrc start position,
+	// then plays random legal moves - 8 or 9 from a start position,
+	// or config.randomPlies from a book position
+	[[nodiscard]] auto playOpening(u32 id, const Config &config, const OpeningBook *book,
+		util::rng::Jsf64Rng &rng, Position &pos) -> Opening;
+
+	struct GameResult
+	{
+		Outcome outcome;
+		Ending ending;
+	};
+
+	// the side to move has no legal moves, and has lost
+	[[nodiscard]] inline auto noLegalMovesResult(const Position &pos)
+	{
+		return GameResult{
+			.outcome = pos.toMove() == Color::Black ? Outcome::WhiteWin : Outcome::WhiteLoss,
+			.ending = Ending::NoLegalMoves,
+		};
+	}
+
+	// bare king wins and draws by rule, checked after each move
+	[[nodiscard]] auto terminalResult(const Position &pos) -> std::optional<GameResult>;
+
+	class Adjudicator
+	{
+	public:
+		explicit Adjudicator(const Knobs &knobs) : m_knobs{knobs} {}
+
+		// score and normScore are the white relative results of each search
+		[[nodiscard]] auto update(Score score, Score normScore) -> std::optional<GameResult>;
+
+	private:
+		const Knobs &m_knobs;
+
+		u32 m_winPlies{};
+		u32 m_lossPlies{};
+		u32 m_drawPlies{};
+	};
+}
@@ -0,0 +1,254 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "manifest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace oranj::datagen
+{
+	namespace
+	{
+		constexpr u32 ManifestVersion = 1;
+
+		auto syncFile(std::FILE *file) -> bool
+		{
+			if (std::fflush(file) != 0)
+				return false;
+
+#ifdef _WIN32
+			return _commit(_fileno(file)) == 0;
+#else
+			return fsync(fileno(file)) == 0;
+#endif
+		}
+
+		// makes a rename within dir durable
+		auto syncDir([[maybe_unused]] const std::filesystem::path &dir)
+		{
+#ifndef _WIN32
+			const auto fd = open(dir.c_str(), O_RDONLY);
+
+			if (fd < 0)
+				return;
+
+			fsync(fd);
+			close(fd);
+#endif
+		}
+	}
+
+	auto writeManifest(const std::filesystem::path &dir, const Manifest &manifest) -> bool
+	{
+		std::ostringstream str{};
+
+		str << "version " << ManifestVersion << '\n';
+		str << "format " << manifest.config.format << '\n';
+		str << "variant " << (manifest.config.dfrc ? "dfrc" : "standard") << '\n';
+		str << "threads " << manifest.config.threads << '\n';
+		str << "games " << manifest.config.games << '\n';
+		str << "tt " << manifest.config.ttSizeMib << '\n';
+		str << "seed " << manifest.seed << '\n';
+
+		writeKnobs(str, manifest.config.knobs);
+
+		if (!manifest.config.openings.empty())
+		{
+			str << "openings " << manifest.config.openings << '\n';
+			str << "randomplies " << manifest.config.randomPlies << '\n';
+		}
+
+		for (usize i = 0; i < manifest.threads.size(); ++i)
+		{
+			const auto &checkpoint = manifest.threads[i];
+
+			str << "thread " << i
+				<< ' ' << checkpoint.games
+				<< ' ' << checkpoint.positions
+				<< ' ' << checkpoint.offset;
+
+			for (const auto word : checkpoint.rng)
+			{
+				str << ' ' << word;
+			}
+
+			str << '\n';
+		}
+
+		const auto content = str.str();
+
+		const auto path = dir / ManifestFilename;
+		auto tmpPath = path;
+		tmpPath += ".tmp";
+
+		auto *file = std::fopen(tmpPath.string().c_str(), "wb");
+
+		if (!file)
+		{
+			std::cerr << "failed to open " << tmpPath << std::endl;
+			return false;
+		}
+
+		const bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size()
+			&& syncFile(file);
+
+		std::fclose(file);
+
+		if (!written)
+		{
+			std::cerr << "failed to write " << tmpPath << std::endl;
+			return false;
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tmpPath, path, error);
+
+		if (error)
+		{
+			std::cerr << "failed to replace " << path << ": " << error.message() << std::endl;
+			return false;
+		}
+
+		syncDir(dir);
+
+		return true;
+	}
+
+	auto readManifest(const std::filesystem::path &dir) -> std::optional<Manifest>
+	{
+		const auto path = dir / ManifestFilename;
+		std::ifstream stream{path};
+
+		if (!stream)
+		{
+			std::cerr << "failed to open " << path << std::endl;
+			return {};
+		}
+
+		Manifest manifest{};
+
+		const auto fail = [&](const std::string &line) -> std::optional<Manifest>
+		{
+			std::cerr << "invalid manifest line: " << line << std::endl;
+			return {};
+		};
+
+		bool versionFound = false;
+
+		for (std::string line{}; std::getline(stream, line);)
+		{
+			if (line.empty())
+				continue;
+
+			std::istringstream lineStream{line};
+
+			std::string key{};
+			lineStream >> key;
+
+			if (key == "version")
+			{
+				u32 version{};
+
+				if (!(lineStream >> version) || version != ManifestVersion)
+				{
+					std::cerr << "unsupported manifest version" << std::endl;
+					return {};
+				}
+
+				versionFound = true;
+				continue;
+			}
+
+			bool valid;
+
+			if (key == "format")
+				valid = static_cast<bool>(lineStream >> manifest.config.format);
+			else if (key == "variant")
+			{
+				std::string variant{};
+				valid = (lineStream >> variant) && (variant == "standard" || variant == "dfrc");
+				manifest.config.dfrc = variant == "dfrc";
+			}
+			else if (key == "threads")
+				valid = static_cast<bool>(lineStream >> manifest.config.threads);
+			else if (key == "games")
+				valid = static_cast<bool>(lineStream >> manifest.config.games);
+			else if (key == "tt")
+				valid = static_cast<bool>(lineStream >> manifest.config.ttSizeMib);
+			else if (key == "seed")
+				valid = static_cast<bool>(lineStream >> manifest.seed);
+			else if (key == "openings")
+			{
+				// paths may contain spaces
+				lineStream >> std::ws;
+				valid = static_cast<bool>(std::getline(lineStream, manifest.config.openings));
+			}
+			else if (key == "randomplies")
+				valid = static_cast<bool>(lineStream >> manifest.config.randomPlies);
+			else if (key == "thread")
+			{
+				usize idx{};
+				Checkpoint checkpoint{};
+
+				valid = static_cast<bool>(lineStream >> idx
+					>> checkpoint.games >> checkpoint.positions >> checkpoint.offset
+					>> checkpoint.rng[0] >> checkpoint.rng[1] >> checkpoint.rng[2] >> checkpoint.rng[3])
+					&& idx == manifest.threads.size();
+
+				manifest.threads.push_back(checkpoint);
+			}
+			else
+			{
+				std::string value{};
+				valid = (lineStream >> value) && setKnob(manifest.config.knobs, key, value);
+			}
+
+			if (!valid)
+				return fail(line);
+		}
+
+		if (!versionFound)
+		{
+			std::cerr << "manifest has no version" << std::endl;
+			return {};
+		}
+
+		if (manifest.config.threads == 0 || manifest.threads.size() != manifest.config.threads)
+		{
+			std::cerr << "manifest has " << manifest.threads.size()
+				<< " thread checkpoints, expected " << manifest.config.threads << std::endl;
+			return {};
+		}
+
+		manifest.config.output = dir.string();
+		manifest.config.seed = manifest.seed;
+
+		return manifest;
+	}
+}
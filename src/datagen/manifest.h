@@ -0,0 +1,58 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+#include "config.h"
+
+namespace oranj::datagen
+{
+	// a point between two games in one thread's output
+	struct Checkpoint
+	{
+		u64 games{};
+		u64 positions{};
+		// size of the output file once every game up to here is written
+		u64 offset{};
+		// state of the thread's rng at the start of the next game
+		std::array<u64, 4> rng{};
+	};
+
+	// Everything needed to continue a run exactly where it stopped.
+	// Each game depends only on the rng state it starts from, so restoring
+	// the rng and truncating the output to the checkpointed offset is enough
+	struct Manifest
+	{
+		Config config{};
+		u64 seed{};
+		std::vector<Checkpoint> threads{};
+	};
+
+	constexpr auto ManifestFilename = "manifest.txt";
+
+	// replaces the manifest in dir atomically, syncing it to disk first
+	auto writeManifest(const std::filesystem::path &dir, const Manifest &manifest) -> bool;
+	[[nodiscard]] auto readManifest(const std::filesystem::path &dir) -> std::optional<Manifest>;
+}
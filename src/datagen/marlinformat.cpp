@@ -18,8 +18,92 @@
 
 #include "marlinformat.h"
 
+#include <array>
+#include <algorithm>
+#include <string>
+
 namespace oranj::datagen
 {
+	namespace marlinformat
+	{
+		auto PackedBoard::unpack(Position &dst) const -> bool
+		{
+			std::array<Piece, 64> squares{};
+			squares.fill(Piece::None);
+
+			auto occ = Bitboard{occupancy};
+
+			usize i = 0;
+			while (occ)
+			{
+				const auto square = occ.popLowestSquare();
+				const auto id = static_cast<u8>(pieces[i++] & 0xF);
+
+				const auto type = static_cast<PieceType>(id & 0x7);
+				const auto color = (id & (1 << 3)) != 0 ? Color::Black : Color::White;
+
+				if (type >= PieceType::None)
+					return false;
+
+				squares[static_cast<i32>(square)] = colorPiece(type, color);
+			}
+
+			std::string fen{};
+			fen.reserve(96);
+
+			for (i32 rank = 7; rank >= 0; --rank)
+			{
+				for (i32 file = 0; file < 8; ++file)
+				{
+					const auto piece = squares[rank * 8 + file];
+
+					if (piece == Piece::None)
+					{
+						u32 emptySquares = 1;
+						for (; file < 7 && squares[rank * 8 + file + 1] == Piece::None; ++file, ++emptySquares) {}
+
+						fen += static_cast<char>('0' + emptySquares);
+					}
+					else fen += pieceToChar(piece);
+				}
+
+				if (rank > 0)
+					fen += '/';
+			}
+
+			fen += (stmEpSquare & (1 << 7)) != 0 ? " b - - " : " w - - ";
+
+			fen += std::to_string(halfmoveClock);
+			fen += ' ';
+			fen += std::to_string(fullmoveNumber);
+
+			return dst.resetFromFen(fen);
+		}
+
+		auto packFens(std::string_view fens, std::vector<PackedBoard> &dst) -> usize
+		{
+			Position pos{};
+			usize failed = 0;
+
+			while (!fens.empty())
+			{
+				const auto end = std::min(fens.find('\n'), fens.size());
+				const auto line = fens.substr(0, end);
+
+				fens.remove_prefix(std::min(end + 1, fens.size()));
+
+				if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+					continue;
+
+				if (pos.resetFromFen(line))
+					dst.push_back(PackedBoard::pack(pos, 0));
+				else ++failed;
+			}
+
+			return failed;
+		}
+	}
+
 	Marlinformat::Marlinformat()
 	{
 		m_positions.reserve(256);
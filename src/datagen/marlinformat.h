@@ -21,6 +21,7 @@
 #include "../types.h"
 
 #include <vector>
+#include <string_view>
 
 #include "format.h"
 #include "../position/position.h"
@@ -74,7 +75,15 @@ namespace oranj::datagen
 
 				return board;
 			}
+
+			// castling and en passant do not exist in shatranj,
+			// so the packed board is enough to fully restore a position
+			[[nodiscard]] auto unpack(Position &dst) const -> bool;
 		};
+
+		// Packs every fen in a newline-separated buffer into dst, with an eval of 0.
+		// Blank lines are skipped, returns the number of lines that failed to parse
+		auto packFens(std::string_view fens, std::vector<PackedBoard> &dst) -> usize;
 	}
 
 	class Marlinformat
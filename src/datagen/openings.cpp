@@ -0,0 +1,154 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "openings.h"
+
+#include <array>
+#include <iostream>
+#include <algorithm>
+
+namespace oranj::datagen
+{
+	namespace
+	{
+		// attempts before giving up on a shard full of invalid lines
+		constexpr u32 MaxPickAttempts = 64;
+
+		[[nodiscard]] auto isNumber(std::string_view str)
+		{
+			return !str.empty() && std::ranges::all_of(str, [](char c) { return c >= '0' && c <= '9'; });
+		}
+	}
+
+	auto OpeningBook::open(const std::string &path, u32 shards) -> std::unique_ptr<OpeningBook>
+	{
+		auto file = util::MappedFile::open(path);
+
+		if (!file)
+			return nullptr;
+
+		std::unique_ptr<OpeningBook> book{new OpeningBook{std::move(file)}};
+
+		const auto data = book->m_file->data();
+
+		// moves a shard boundary forward to the start of the next line
+		const auto lineStart = [&](usize offset)
+		{
+			if (offset == 0)
+				return offset;
+
+			while (offset < data.size() && data[offset - 1] != '\n')
+			{
+				++offset;
+			}
+
+			return offset;
+		};
+
+		usize begin = 0;
+
+		for (u32 i = 0; i < shards; ++i)
+		{
+			const auto end = lineStart(data.size() * (i + 1) / shards);
+
+			if (end <= begin)
+			{
+				std::cerr << "opening book " << path << " has too few lines for " << shards << " threads" << std::endl;
+				return nullptr;
+			}
+
+			book->m_shards.push_back(data.subspan(begin, end - begin));
+			begin = end;
+		}
+
+		return book;
+	}
+
+	auto OpeningBook::pick(u32 shard, util::rng::Jsf64Rng &rng, Position &dst) const -> bool
+	{
+		const auto data = m_shards[shard];
+
+		for (u32 attempt = 0; attempt < MaxPickAttempts; ++attempt)
+		{
+			auto offset = static_cast<usize>(rng.nextU64() % data.size());
+
+			// back up to the start of the line
+			while (offset > 0 && data[offset - 1] != '\n')
+			{
+				--offset;
+			}
+
+			const auto remaining = data.subspan(offset);
+			const auto end = std::ranges::find(remaining, '\n');
+
+			const std::string_view line{remaining.data(), static_cast<usize>(end - remaining.begin())};
+
+			if (const auto fen = parseLine(line); fen && dst.resetFromFen(*fen))
+				return true;
+		}
+
+		return false;
+	}
+
+	auto OpeningBook::parseLine(std::string_view line) -> std::optional<std::string>
+	{
+		if (const auto end = line.find_first_of(";|"); end != std::string_view::npos)
+			line = line.substr(0, end);
+
+		std::array<std::string_view, 6> fields{};
+		usize count = 0;
+
+		usize pos = 0;
+
+		while (count < fields.size())
+		{
+			pos = line.find_first_not_of(" \t\r", pos);
+
+			if (pos == std::string_view::npos)
+				break;
+
+			const auto end = std::min(line.find_first_of(" \t\r", pos), line.size());
+
+			fields[count++] = line.substr(pos, end - pos);
+			pos = end;
+		}
+
+		if (count < 4)
+			return {};
+
+		std::string fen{};
+		fen.reserve(line.size() + 4);
+
+		for (usize i = 0; i < 4; ++i)
+		{
+			fen += fields[i];
+			fen += ' ';
+		}
+
+		// EPDs have no move counters, and their operations are not numbers
+		if (count == 6 && isNumber(fields[4]) && isNumber(fields[5]))
+		{
+			fen += fields[4];
+			fen += ' ';
+			fen += fields[5];
+		}
+		else fen += "0 1";
+
+		return fen;
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <string_view>
+
+#include "../position/position.h"
+#include "../util/mapped_file.h"
+#include "../util/rng.h"
+
+namespace oranj::datagen
+{
+	// Starting positions for datagen, one FEN or EPD per line. The file is
+	// memory mapped and split into one contiguous byte range per thread
+	class OpeningBook
+	{
+	public:
+		[[nodiscard]] static auto open(const std::string &path, u32 shards) -> std::unique_ptr<OpeningBook>;
+
+		// picks a random line from the given shard. the choice is weighted by the
+		// chosen line's own length (including its newline), which is close enough
+		// to uniform for books whose lines are of similar length.
+		// false if no valid position was found
+		[[nodiscard]] auto pick(u32 shard, util::rng::Jsf64Rng &rng, Position &dst) const -> bool;
+
+		// accepts FENs, with or without move counters, and EPDs with operations.
+		// anything after a ';' or '|' is ignored
+		[[nodiscard]] static auto parseLine(std::string_view line) -> std::optional<std::string>;
+
+	private:
+		explicit OpeningBook(std::unique_ptr<util::MappedFile> file)
+			: m_file{std::move(file)} {}
+
+		std::unique_ptr<util::MappedFile> m_file;
+		std::vector<std::span<const char>> m_shards{};
+	};
+}
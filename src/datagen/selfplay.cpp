@@ -0,0 +1,445 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "selfplay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "game.h"
+#include "openings.h"
+#include "../eval/nnue.h"
+#include "../opts.h"
+#include "../search.h"
+#include "../util/ctrlc.h"
+#include "../util/rng.h"
+#include "../util/timer.h"
+
+namespace oranj::datagen::selfplay
+{
+	using util::Instant;
+
+	namespace
+	{
+		std::atomic_bool s_stop{false};
+
+		// pairs
+		constexpr u64 ReportInterval = 16;
+
+		// 95% confidence
+		constexpr f64 ErrorZ = 1.959964;
+
+		struct Player
+		{
+			const Side *side;
+
+			DatagenNodeLimiter *limiter;
+			std::unique_ptr<search::Searcher> searcher;
+			std::unique_ptr<search::ThreadData> thread;
+		};
+
+		// all results are from the point of view of the first side
+		struct MatchResults
+		{
+			// [loss, draw, win]
+			std::array<u64, 3> games{};
+			// pair scores of 0, 0.5, 1, 1.5 and 2
+			std::array<u64, 5> pairs{};
+
+			std::array<u64, 2> nodes{};
+			std::array<f64, 2> searchTime{};
+		};
+
+		struct EloEstimate
+		{
+			f64 elo;
+			f64 error;
+		};
+
+		[[nodiscard]] auto scoreToElo(f64 score)
+		{
+			static constexpr f64 Epsilon = 1e-6;
+
+			score = std::clamp(score, Epsilon, 1.0 - Epsilon);
+			return -400.0 * std::log10(1.0 / score - 1.0);
+		}
+
+		// paired games are not independent, so the
+		// variance is taken over pairs rather than games
+		[[nodiscard]] auto pentanomialElo(const std::array<u64, 5> &pairs) -> std::optional<EloEstimate>
+		{
+			u64 total{};
+			for (const auto count : pairs)
+			{
+				total += count;
+			}
+
+			if (total == 0)
+				return {};
+
+			f64 mean{};
+			for (usize i = 0; i < pairs.size(); ++i)
+			{
+				mean += static_cast<f64>(pairs[i]) * (static_cast<f64>(i) / 4.0);
+			}
+
+			mean /= static_cast<f64>(total);
+
+			f64 variance{};
+			for (usize i = 0; i < pairs.size(); ++i)
+			{
+				const auto deviation = static_cast<f64>(i) / 4.0 - mean;
+				variance += static_cast<f64>(pairs[i]) * deviation * deviation;
+			}
+
+			variance /= static_cast<f64>(total);
+
+			const auto margin = ErrorZ * std::sqrt(variance / static_cast<f64>(total));
+
+			return EloEstimate{
+				.elo = scoreToElo(mean),
+				.error = (scoreToElo(mean + margin) - scoreToElo(mean - margin)) / 2.0,
+			};
+		}
+
+		auto sideName(const MatchConfig &config, usize idx)
+		{
+			const auto &side = config.sides[idx];
+
+			std::string name{idx == 0 ? "A" : "B"};
+
+			if (!side.network.empty())
+				name += " (" + side.network + ")";
+
+			return name;
+		}
+
+		auto printResults(const MatchConfig &config, const MatchResults &results)
+		{
+			const auto [losses, draws, wins] = results.games;
+
+			std::cout << "games: " << (wins + draws + losses) << ", " << sideName(config, 0) << " vs "
+				<< sideName(config, 1) << ": +" << wins << " =" << draws << " -" << losses << std::endl;
+
+			std::cout << "pairs (0 - 2): ";
+			for (usize i = 0; i < results.pairs.size(); ++i)
+			{
+				std::cout << (i == 0 ? "" : ", ") << results.pairs[i];
+			}
+			std::cout << std::endl;
+
+			std::cout << std::fixed << std::setprecision(1);
+
+			if (const auto elo = pentanomialElo(results.pairs))
+				std::cout << "elo: " << elo->elo << " +/- " << elo->error << std::endl;
+
+			for (usize i = 0; i < 2; ++i)
+			{
+				const auto nps = static_cast<f64>(results.nodes[i]) / std::max(results.searchTime[i], 0.001);
+				std::cout << sideName(config, i) << ": " << static_cast<u64>(nps) << " nps" << std::endl;
+			}
+
+			std::cout << std::defaultfloat;
+		}
+
+		auto resetPlayer(Player &player, const Position &start)
+		{
+			player.searcher->newGame();
+
+			auto &thread = *player.thread;
+
+			thread.resetForNewGame();
+			thread.search = search::SearchData{};
+
+			thread.pos = start;
+			thread.pos.clearStateHistory();
+
+			thread.nnueState.reset(thread.pos.bbs(), thread.pos.kings());
+		}
+
+		// players are indexed by side, so the first side is white when firstIsWhite is set
+		auto playGame(std::array<Player, 2> &players, bool firstIsWhite,
+			const Position &start, const Knobs &knobs, MatchResults &results) -> GameResult
+		{
+			for (auto &player : players)
+			{
+				resetPlayer(player, start);
+			}
+
+			Adjudicator adjudicator{knobs};
+
+			while (true)
+			{
+				const auto whiteToMove = players[0].thread->pos.toMove() == Color::White;
+				const usize moverIdx = whiteToMove == firstIsWhite ? 0 : 1;
+
+				auto &mover = players[moverIdx];
+				const auto &side = *mover.side;
+
+				const auto softNodes = side.nodes
+					? *side.nodes
+					: side.depth ? std::numeric_limits<usize>::max() : knobs.softNodes;
+
+				mover.limiter->setSoftNodeLimit(softNodes);
+				mover.limiter->setHardNodeLimit(std::max(knobs.hardNodes, side.nodes.value_or(0)));
+
+				mover.thread->maxDepth = side.depth.value_or(MaxDepth);
+
+				const auto searchStart = Instant::now();
+				const auto [score, normScore] = mover.searcher->runDatagenSearch(*mover.thread);
+
+				results.searchTime[moverIdx] += searchStart.elapsed();
+				results.nodes[moverIdx] += mover.thread->search.loadNodes();
+
+				mover.thread->search = search::SearchData{};
+
+				const auto move = mover.thread->rootPv.moves[0];
+
+				if (!move)
+					return noLegalMovesResult(mover.thread->pos);
+
+				const auto adjudicated = adjudicator.update(score, normScore);
+
+				for (auto &player : players)
+				{
+					player.thread->pos.applyMoveUnchecked<true, false>(move, &player.thread->nnueState);
+				}
+
+				if (const auto result = terminalResult(players[0].thread->pos))
+					return *result;
+
+				if (adjudicated)
+					return *adjudicated;
+
+				if (s_stop.load(std::memory_order::relaxed))
+					return {Outcome::Draw, Ending::DrawAdjudication};
+			}
+		}
+
+		auto runThread(u32 id, const MatchConfig &config, const std::array<const eval::Network *, 2> &networks,
+			const OpeningBook *book, u64 seed,
+			std::atomic<u64> &nextPair, u64 totalPairs, MatchResults &totals, std::mutex &totalsMutex)
+		{
+			const auto &knobs = config.base.knobs;
+
+			util::rng::Jsf64Rng rng{seed};
+
+			std::array<Player, 2> players{};
+
+			for (usize i = 0; i < players.size(); ++i)
+			{
+				auto &player = players[i];
+
+				auto limiter = std::make_unique<DatagenNodeLimiter>(id);
+
+				player.side = &config.sides[i];
+				player.limiter = limiter.get();
+
+				player.searcher = std::make_unique<search::Searcher>(config.base.ttSizeMib, search::NoSearchThreads);
+				player.searcher->setLimiter(std::move(limiter));
+
+				player.thread = std::make_unique<search::ThreadData>();
+				player.thread->nnueState.setNetwork(*networks[i]);
+			}
+
+			Position opening{};
+
+			while (!s_stop.load(std::memory_order::relaxed))
+			{
+				const auto pair = nextPair.fetch_add(1, std::memory_order::relaxed);
+				if (pair >= totalPairs)
+					break;
+
+				// find a playable opening, verified with the first side's search
+				while (true)
+				{
+					const auto result = playOpening(id, config.base, book, rng, opening);
+
+					if (result.status == OpeningStatus::NoBookPositions)
+					{
+						std::cerr << "thread " << id << ": no valid positions found in opening book" << std::endl;
+						return;
+					}
+
+					if (result.status == OpeningStatus::Rejected)
+						continue;
+
+					if (!result.verify)
+						break;
+
+					auto &verifier = players[0];
+
+					resetPlayer(verifier, opening);
+
+					verifier.thread->maxDepth = 10;
+					verifier.limiter->setSoftNodeLimit(std::numeric_limits<usize>::max());
+					verifier.limiter->setHardNodeLimit(knobs.verificationHardNodes);
+
+					const auto [score, normScore] = verifier.searcher->runDatagenSearch(*verifier.thread);
+
+					if (std::abs(normScore) <= knobs.verificationScoreLimit)
+						break;
+				}
+
+				MatchResults results{};
+
+				// the last pair is only half played if the game count is odd
+				const auto games = pair * 2 + 1 < static_cast<u64>(config.base.games) ? 2 : 1;
+				usize pairScore{};
+
+				for (usize game = 0; game < games; ++game)
+				{
+					const bool firstIsWhite = game == 0;
+
+					const auto [outcome, ending] = playGame(players, firstIsWhite, opening, knobs, results);
+
+					// [loss, draw, win] for the first side
+					const auto score = firstIsWhite
+						? static_cast<usize>(outcome)
+						: 2 - static_cast<usize>(outcome);
+
+					++results.games[score];
+					pairScore += score;
+				}
+
+				if (s_stop.load(std::memory_order::relaxed))
+					break;
+
+				if (games == 2)
+					++results.pairs[pairScore];
+
+				const std::unique_lock lock{totalsMutex};
+
+				for (usize i = 0; i < 3; ++i)
+				{
+					totals.games[i] += results.games[i];
+				}
+
+				for (usize i = 0; i < 5; ++i)
+				{
+					totals.pairs[i] += results.pairs[i];
+				}
+
+				for (usize i = 0; i < 2; ++i)
+				{
+					totals.nodes[i] += results.nodes[i];
+					totals.searchTime[i] += results.searchTime[i];
+				}
+
+				u64 pairsDone{};
+				for (const auto count : totals.pairs)
+				{
+					pairsDone += count;
+				}
+
+				if (pairsDone % ReportInterval == 0)
+					printResults(config, totals);
+			}
+		}
+	}
+
+	auto run(const MatchConfig &config) -> i32
+	{
+		if (config.base.games == 0 || config.base.games == UnlimitedGames)
+		{
+			std::cerr << "selfplay needs a game limit" << std::endl;
+			return 1;
+		}
+
+		if (!validateKnobs(config.base.knobs))
+			return 1;
+
+		std::array<std::unique_ptr<eval::Network>, 2> loadedNetworks{};
+		std::array<const eval::Network *, 2> networks{&eval::g_network, &eval::g_network};
+
+		for (usize i = 0; i < 2; ++i)
+		{
+			const auto &network = config.sides[i].network;
+
+			if (network.empty())
+				continue;
+
+			if (!(loadedNetworks[i] = eval::readNetwork(network)))
+				return 1;
+
+			networks[i] = loadedNetworks[i].get();
+		}
+
+		opts::mutableOpts().chess960 = config.base.dfrc;
+
+		std::unique_ptr<OpeningBook> book{};
+
+		if (!config.base.openings.empty())
+		{
+			book = OpeningBook::open(config.base.openings, config.base.threads);
+
+			if (!book)
+				return 1;
+		}
+
+		const auto seed = config.base.seed.value_or(util::rng::generateSingleSeed());
+		std::cout << "seed: " << seed << std::endl;
+
+		util::rng::SeedGenerator seedGenerator{seed};
+
+		util::signal::addCtrlCHandler([]
+		{
+			s_stop.store(true, std::memory_order::seq_cst);
+		});
+
+		const auto totalPairs = (static_cast<u64>(config.base.games) + 1) / 2;
+
+		std::cout << "playing " << config.base.games << " games on " << config.base.threads << " threads" << std::endl;
+
+		std::atomic<u64> nextPair{0};
+
+		MatchResults totals{};
+		std::mutex totalsMutex{};
+
+		const auto startTime = Instant::now();
+
+		std::vector<std::thread> threads{};
+		threads.reserve(config.base.threads);
+
+		for (u32 i = 0; i < config.base.threads; ++i)
+		{
+			threads.emplace_back([&, i, threadSeed = seedGenerator.nextSeed()]
+			{
+				runThread(i, config, networks, book.get(), threadSeed, nextPair, totalPairs, totals, totalsMutex);
+			});
+		}
+
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+
+		std::cout << "finished in " << startTime.elapsed() << " sec" << std::endl;
+		printResults(config, totals);
+
+		return 0;
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <optional>
+#include <string>
+
+#include "config.h"
+
+namespace oranj::datagen::selfplay
+{
+	// one of the two engine configurations in a match
+	struct Side
+	{
+		// empty for the embedded network
+		std::string network{};
+		// soft node limit, overriding the soft-nodes knob
+		std::optional<usize> nodes{};
+		// if given without nodes, the soft node limit is lifted
+		std::optional<i32> depth{};
+	};
+
+	struct MatchConfig
+	{
+		// threads, dfrc, ttSizeMib (per side), seed, openings, randomPlies and
+		// knobs are used as in datagen. games is the total number of games
+		Config base{};
+		std::array<Side, 2> sides{};
+	};
+
+	// Plays games between the two sides in this process, with the openings,
+	// search and adjudication of datagen. Each opening is played twice with
+	// colours reversed, and the result is reported as elo for the first side.
+	auto run(const MatchConfig &config) -> i32;
+}
@@ -0,0 +1,118 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stats.h"
+
+#include <iostream>
+#include <iomanip>
+
+namespace oranj::datagen
+{
+	namespace
+	{
+		constexpr std::array PhaseNames{
+			"walk",
+			"verification",
+			"search",
+			"serialisation",
+			"io",
+		};
+
+		constexpr std::array EndingNames{
+			"no legal moves",
+			"mate score",
+			"win adjudication",
+			"draw adjudication",
+			"bare king",
+			"draw rule",
+		};
+
+		static_assert(PhaseNames.size() == static_cast<usize>(Phase::Count));
+		static_assert(EndingNames.size() == static_cast<usize>(Ending::Count));
+
+		[[nodiscard]] auto percent(f64 a, f64 b)
+		{
+			return b == 0.0 ? 0.0 : a / b * 100.0;
+		}
+	}
+
+	auto printSummary(std::span<const ThreadStats> stats, f64 time, f64 writerBusyTime) -> void
+	{
+		const auto total = [&](auto key)
+		{
+			decltype(stats[0].get(key)) sum{};
+
+			for (const auto &thread : stats)
+			{
+				sum += thread.get(key);
+			}
+
+			return sum;
+		};
+
+		const auto games = total(Counter::Games);
+		const auto positions = total(Counter::Positions);
+		const auto moves = total(Counter::Moves);
+
+		const auto walkRejects = total(Counter::WalkRejects);
+		const auto verificationRejects = total(Counter::VerificationRejects);
+		const auto openings = games + walkRejects + verificationRejects;
+
+		const auto flags = std::cout.flags();
+		const auto precision = std::cout.precision();
+
+		std::cout << std::fixed << std::setprecision(1);
+
+		std::cout << "summary: " << games << " games, " << positions << " positions in " << time << " sec on "
+			<< stats.size() << " threads (" << (static_cast<f64>(positions) / time) << " positions/sec, "
+			<< (static_cast<f64>(games) / time) << " games/sec)" << std::endl;
+
+		f64 threadTime{};
+		for (usize i = 0; i < static_cast<usize>(Phase::Count); ++i)
+		{
+			threadTime += total(static_cast<Phase>(i));
+		}
+
+		std::cout << "  time:";
+		for (usize i = 0; i < static_cast<usize>(Phase::Count); ++i)
+		{
+			std::cout << ' ' << PhaseNames[i] << ' ' << percent(total(static_cast<Phase>(i)), threadTime) << '%';
+		}
+		std::cout << ", writer busy " << percent(writerBusyTime, time) << '%' << std::endl;
+
+		std::cout << "  filtered: check " << percent(total(Counter::FilteredCheck), moves)
+			<< "%, noisy " << percent(total(Counter::FilteredNoisy), moves)
+			<< "%, terminal " << percent(total(Counter::FilteredTerminal), moves) << "% of "
+			<< moves << " positions" << std::endl;
+
+		std::cout << "  openings rejected: walk " << percent(walkRejects, openings)
+			<< "%, verification " << percent(verificationRejects, openings) << "% of "
+			<< openings << std::endl;
+
+		std::cout << "  endings:";
+		for (usize i = 0; i < static_cast<usize>(Ending::Count); ++i)
+		{
+			std::cout << (i == 0 ? " " : ", ") << EndingNames[i] << ' '
+				<< percent(total(static_cast<Ending>(i)), games) << '%';
+		}
+		std::cout << std::endl;
+
+		std::cout.flags(flags);
+		std::cout.precision(precision);
+	}
+}
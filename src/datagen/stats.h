@@ -0,0 +1,118 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+#include <array>
+#include <atomic>
+
+namespace oranj::datagen
+{
+	enum class Phase : u32
+	{
+		// resetting search state, then random plies or picking a book position
+		Walk = 0,
+		Verification,
+		Search,
+		// formatting finished games
+		Serialisation,
+		// handing blocks to the writer, including waiting for it
+		Io,
+		Count,
+	};
+
+	enum class Counter : u32
+	{
+		Games = 0,
+		Positions,
+		// moves played in recorded games
+		Moves,
+		// filtered moves, split by the first reason that applied
+		FilteredCheck,
+		FilteredNoisy,
+		FilteredTerminal,
+		// openings thrown away before a game was played
+		WalkRejects,
+		VerificationRejects,
+		Count,
+	};
+
+	enum class Ending : u32
+	{
+		// checkmate or stalemate on the board
+		NoLegalMoves = 0,
+		MateScore,
+		WinAdjudication,
+		DrawAdjudication,
+		BareKing,
+		// repetition or 50 move rule
+		DrawRule,
+		Count,
+	};
+
+	// Each thread's stats are only written by that thread, but may
+	// be read at any time by the thread printing summaries
+	class ThreadStats
+	{
+	public:
+		inline auto add(Counter counter, u64 value = 1)
+		{
+			auto &c = m_counters[static_cast<usize>(counter)];
+			c.store(c.load(std::memory_order::relaxed) + value, std::memory_order::relaxed);
+		}
+
+		inline auto addEnding(Ending ending)
+		{
+			auto &c = m_endings[static_cast<usize>(ending)];
+			c.store(c.load(std::memory_order::relaxed) + 1, std::memory_order::relaxed);
+		}
+
+		inline auto addTime(Phase phase, f64 time)
+		{
+			auto &t = m_times[static_cast<usize>(phase)];
+			t.store(t.load(std::memory_order::relaxed) + time, std::memory_order::relaxed);
+		}
+
+		[[nodiscard]] inline auto get(Counter counter) const
+		{
+			return m_counters[static_cast<usize>(counter)].load(std::memory_order::relaxed);
+		}
+
+		[[nodiscard]] inline auto get(Ending ending) const
+		{
+			return m_endings[static_cast<usize>(ending)].load(std::memory_order::relaxed);
+		}
+
+		[[nodiscard]] inline auto get(Phase phase) const
+		{
+			return m_times[static_cast<usize>(phase)].load(std::memory_order::relaxed);
+		}
+
+	private:
+		std::array<std::atomic<u64>, static_cast<usize>(Counter::Count)> m_counters{};
+		std::array<std::atomic<u64>, static_cast<usize>(Ending::Count)> m_endings{};
+		std::array<std::atomic<f64>, static_cast<usize>(Phase::Count)> m_times{};
+	};
+
+	// aggregated across threads. writerBusyTime is the time the writer
+	// thread spent writing and syncing, out of the time elapsed
+	auto printSummary(std::span<const ThreadStats> stats, f64 time, f64 writerBusyTime) -> void;
+}
@@ -0,0 +1,1151 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tools.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "marlinformat.h"
+#include "viriformat.h"
+#include "../see.h"
+#include "../util/mapped_file.h"
+#include "../util/rng.h"
+#include "../util/timer.h"
+
+namespace oranj::datagen::tools
+{
+	namespace
+	{
+		constexpr usize IoBufferSize = 8 * 1024 * 1024;
+
+		constexpr usize MinBucketBufferSize = 64 * 1024;
+		constexpr usize MaxBucketBufferSize = 4 * 1024 * 1024;
+
+		// rough ratio of the memory needed to process a
+		// bucket in pass two (data, output and indices) to its size
+		constexpr usize BucketMemoryFactor = 3;
+
+		constexpr usize PackedBoardSize = sizeof(marlinformat::PackedBoard);
+		// u16 move, i16 score
+		constexpr usize ViriformatMoveSize = 4;
+
+		// occupancy, pieces and side to move - the parts of a packed
+		// board that identify a position, without clocks, score or outcome
+		constexpr usize PositionKeySize = 25;
+
+		enum class RecordFormat
+		{
+			Marlinformat,
+			Viriformat,
+		};
+
+		enum class ReadResult
+		{
+			Ok,
+			End,
+			Truncated,
+		};
+
+		auto parseFormat(const std::string &format) -> std::optional<RecordFormat>
+		{
+			if (format == "marlinformat")
+				return RecordFormat::Marlinformat;
+			else if (format == "viriformat")
+				return RecordFormat::Viriformat;
+
+			std::cerr << "unsupported format " << format << " (expected marlinformat or viriformat)" << std::endl;
+			return {};
+		}
+
+		// the buffer must be installed before the file is opened
+		class BufferedInput
+		{
+		public:
+			explicit BufferedInput(const std::string &path)
+				: m_buffer(IoBufferSize)
+			{
+				m_stream.rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+				m_stream.open(path, std::ios::binary);
+
+				if (!m_stream)
+					std::cerr << "failed to open " << path << std::endl;
+			}
+
+			[[nodiscard]] inline auto ok() const
+			{
+				return m_stream.is_open();
+			}
+
+			// record is overwritten with the next record's bytes
+			auto read(RecordFormat format, std::vector<u8> &record) -> ReadResult
+			{
+				record.resize(PackedBoardSize);
+
+				if (!readBytes(record.data(), PackedBoardSize))
+					return m_stream.gcount() == 0 ? ReadResult::End : ReadResult::Truncated;
+
+				if (format == RecordFormat::Marlinformat)
+					return ReadResult::Ok;
+
+				while (true)
+				{
+					const auto offset = record.size();
+					record.resize(offset + ViriformatMoveSize);
+
+					if (!readBytes(&record[offset], ViriformatMoveSize))
+						return ReadResult::Truncated;
+
+					if (std::all_of(record.begin() + offset, record.end(), [](u8 b) { return b == 0; }))
+						return ReadResult::Ok;
+				}
+			}
+
+		private:
+			std::vector<char> m_buffer;
+			std::ifstream m_stream{};
+
+			inline auto readBytes(u8 *dst, usize size) -> bool
+			{
+				return static_cast<bool>(m_stream.read(reinterpret_cast<char *>(dst),
+					static_cast<std::streamsize>(size)));
+			}
+		};
+
+		class BufferedOutput
+		{
+		public:
+			explicit BufferedOutput(const std::string &path)
+				: m_buffer(IoBufferSize)
+			{
+				m_stream.rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+				m_stream.open(path, std::ios::binary | std::ios::trunc);
+
+				if (!m_stream)
+					std::cerr << "failed to open " << path << std::endl;
+			}
+
+			[[nodiscard]] inline auto ok() const
+			{
+				return static_cast<bool>(m_stream);
+			}
+
+			inline auto write(std::span<const u8> data)
+			{
+				m_stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+				m_bytes += data.size();
+			}
+
+			[[nodiscard]] inline auto bytes() const
+			{
+				return m_bytes;
+			}
+
+			auto close() -> bool
+			{
+				m_stream.close();
+				return static_cast<bool>(m_stream);
+			}
+
+		private:
+			std::vector<char> m_buffer;
+			std::ofstream m_stream{};
+
+			usize m_bytes{};
+		};
+
+		// 0 if the record starting at offset is truncated
+		auto recordSize(RecordFormat format, std::span<const u8> data, usize offset) -> usize
+		{
+			if (offset + PackedBoardSize > data.size())
+				return 0;
+
+			if (format == RecordFormat::Marlinformat)
+				return PackedBoardSize;
+
+			for (auto end = offset + PackedBoardSize; end + ViriformatMoveSize <= data.size(); end += ViriformatMoveSize)
+			{
+				if (std::all_of(&data[end], &data[end] + ViriformatMoveSize, [](u8 b) { return b == 0; }))
+					return end + ViriformatMoveSize - offset;
+			}
+
+			return 0;
+		}
+
+		// splitmix64 finaliser, chained over the input words
+		class KeyHasher
+		{
+		public:
+			inline auto add(u64 value)
+			{
+				m_state += value + U64(0x9E3779B97F4A7C15);
+
+				auto z = m_state;
+
+				z = (z ^ (z >> 30)) * U64(0xBF58476D1CE4E5B9);
+				z = (z ^ (z >> 27)) * U64(0x94D049BB133111EB);
+
+				m_state = z ^ (z >> 31);
+			}
+
+			[[nodiscard]] inline auto key() const
+			{
+				return m_state;
+			}
+
+		private:
+			u64 m_state{};
+		};
+
+		// identifies the position for marlinformat, and
+		// the starting position and moves for viriformat
+		auto recordKey(RecordFormat format, std::span<const u8> record) -> u64
+		{
+			const auto load = [&](usize offset, usize size)
+			{
+				u64 value{};
+				std::memcpy(&value, &record[offset], size);
+				return value;
+			};
+
+			KeyHasher hasher{};
+
+			for (usize offset = 0; offset < PositionKeySize; offset += sizeof(u64))
+			{
+				hasher.add(load(offset, std::min(sizeof(u64), PositionKeySize - offset)));
+			}
+
+			if (format == RecordFormat::Viriformat)
+			{
+				// moves only, the scores are not part of the game's identity
+				for (usize offset = PackedBoardSize; offset + ViriformatMoveSize < record.size(); offset += ViriformatMoveSize)
+				{
+					hasher.add(load(offset, sizeof(u16)));
+				}
+			}
+
+			return hasher.key();
+		}
+
+		// Pass one of the bucketed tools. Each bucket is buffered
+		// in memory and appended to its file when the buffer fills,
+		// so that only one bucket file is open at a time
+		class BucketWriter
+		{
+		public:
+			BucketWriter(const std::filesystem::path &dir, usize count, usize bufferSize)
+				: m_bufferSize{bufferSize}
+			{
+				m_buckets.resize(count);
+
+				for (usize i = 0; i < count; ++i)
+				{
+					m_buckets[i].path = dir / ("bucket_" + std::to_string(i));
+					m_buckets[i].buffer.reserve(bufferSize);
+				}
+			}
+
+			auto push(usize bucket, std::span<const u8> record) -> bool
+			{
+				auto &dst = m_buckets[bucket];
+
+				if (dst.buffer.size() + record.size() > m_bufferSize && !flush(dst))
+					return false;
+
+				dst.buffer.insert(dst.buffer.end(), record.begin(), record.end());
+				return true;
+			}
+
+			// also releases the buffers
+			auto finish() -> bool
+			{
+				for (auto &bucket : m_buckets)
+				{
+					if (!flush(bucket))
+						return false;
+
+					bucket.buffer = {};
+				}
+
+				return true;
+			}
+
+			[[nodiscard]] inline auto count() const
+			{
+				return m_buckets.size();
+			}
+
+			[[nodiscard]] inline auto path(usize bucket) const -> const std::filesystem::path &
+			{
+				return m_buckets[bucket].path;
+			}
+
+			[[nodiscard]] inline auto size(usize bucket) const
+			{
+				return m_buckets[bucket].size;
+			}
+
+		private:
+			struct Bucket
+			{
+				std::filesystem::path path{};
+				std::vector<u8> buffer{};
+				usize size{};
+			};
+
+			usize m_bufferSize;
+			std::vector<Bucket> m_buckets{};
+
+			auto flush(Bucket &bucket) -> bool
+			{
+				if (bucket.buffer.empty())
+					return true;
+
+				std::ofstream stream{bucket.path, std::ios::binary | std::ios::app};
+				stream.write(reinterpret_cast<const char *>(bucket.buffer.data()),
+					static_cast<std::streamsize>(bucket.buffer.size()));
+
+				if (!stream)
+				{
+					std::cerr << "failed to write to " << bucket.path << std::endl;
+					return false;
+				}
+
+				bucket.size += bucket.buffer.size();
+				bucket.buffer.clear();
+
+				return true;
+			}
+		};
+
+		// Process(bucket index, data, record offsets, output) fills output with the bucket's
+		// processed records. Buckets are processed in parallel but written in order, so the
+		// output only depends on the seed and the bucket count, not on thread timing
+		template <typename Process>
+		auto processBuckets(RecordFormat format, const BucketWriter &buckets,
+			u32 threadCount, BufferedOutput &output, Process process) -> bool
+		{
+			std::atomic<usize> nextBucket{0};
+			std::atomic_bool failed{false};
+
+			std::mutex outputMutex{};
+			std::condition_variable outputSignal{};
+			usize nextToWrite = 0;
+
+			const auto worker = [&]()
+			{
+				std::vector<u8> data{};
+				std::vector<usize> offsets{};
+				std::vector<u8> result{};
+
+				while (true)
+				{
+					const auto bucket = nextBucket.fetch_add(1, std::memory_order::relaxed);
+					if (bucket >= buckets.count())
+						break;
+
+					data.clear();
+					offsets.clear();
+					result.clear();
+
+					if (!failed.load(std::memory_order::relaxed) && buckets.size(bucket) > 0)
+					{
+						data.resize(buckets.size(bucket));
+
+						std::ifstream stream{buckets.path(bucket), std::ios::binary};
+						if (!stream.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size())))
+						{
+							std::cerr << "failed to read " << buckets.path(bucket) << std::endl;
+							failed.store(true, std::memory_order::relaxed);
+						}
+						else
+						{
+							stream.close();
+							std::filesystem::remove(buckets.path(bucket));
+
+							bool truncated = false;
+
+							for (usize offset = 0; offset < data.size();)
+							{
+								const auto size = recordSize(format, data, offset);
+
+								if (size == 0)
+								{
+									std::cerr << "truncated record at offset " << offset
+										<< " in " << buckets.path(bucket) << std::endl;
+									failed.store(true, std::memory_order::relaxed);
+									truncated = true;
+									break;
+								}
+
+								offsets.push_back(offset);
+								offset += size;
+							}
+
+							if (!truncated)
+							{
+								result.reserve(data.size());
+								process(bucket, std::span<const u8>{data}, std::span<const usize>{offsets}, result);
+							}
+						}
+					}
+
+					// buckets that failed still take their turn, so
+					// that threads waiting on later buckets can finish
+					std::unique_lock lock{outputMutex};
+					outputSignal.wait(lock, [&] { return nextToWrite == bucket; });
+
+					output.write(result);
+					++nextToWrite;
+
+					lock.unlock();
+					outputSignal.notify_all();
+				}
+			};
+
+			std::vector<std::thread> threads{};
+			threads.reserve(threadCount);
+
+			for (u32 i = 0; i < threadCount; ++i)
+			{
+				threads.emplace_back(worker);
+			}
+
+			for (auto &thread : threads)
+			{
+				thread.join();
+			}
+
+			return !failed.load();
+		}
+
+		inline auto recordBytes(std::span<const u8> data, std::span<const usize> offsets, usize idx)
+		{
+			const auto end = idx + 1 < offsets.size() ? offsets[idx + 1] : data.size();
+			return data.subspan(offsets[idx], end - offsets[idx]);
+		}
+
+		auto printRate(f64 time, usize bytes)
+		{
+			const auto mib = static_cast<f64>(bytes) / (1024.0 * 1024.0);
+
+			std::cout << std::fixed << std::setprecision(1) << mib << " MiB in " << time << " sec ("
+				<< (mib / std::max(time, 0.001)) << " MiB/sec)" << std::defaultfloat << std::endl;
+		}
+
+		constexpr Score MaterialBucketWidth = 500;
+		constexpr usize MaterialBuckets = 12;
+
+		constexpr Score EvalBucketWidth = 100;
+		// the outermost buckets are open-ended
+		constexpr usize EvalBuckets = 20;
+
+		constexpr usize GameLengthBucketWidth = 50;
+		constexpr usize GameLengthBuckets = 9;
+
+		// divided into this many chunks per thread, to even out the load
+		constexpr usize AnalysisChunksPerThread = 16;
+
+		struct Analysis
+		{
+			usize records{};
+			usize invalid{};
+
+			usize positions{};
+			std::array<usize, 3> positionOutcomes{};
+			std::array<usize, MaterialBuckets> material{};
+			std::array<usize, EvalBuckets> evals{};
+			usize mateScores{};
+			std::array<usize, 33> pieceCounts{};
+			usize bareKingPositions{};
+
+			// viriformat only
+			usize games{};
+			std::array<usize, 3> gameOutcomes{};
+			std::array<usize, GameLengthBuckets> gameLengths{};
+			usize bareKingGames{};
+
+			auto addPosition(const Position &pos, Score eval, Outcome outcome)
+			{
+				++positions;
+				++positionOutcomes[static_cast<i32>(outcome)];
+
+				const auto &boards = pos.boards();
+
+				Score materialValue{};
+
+				auto occ = pos.bbs().occupancy();
+				pieceCounts[occ.popcount()]++;
+
+				while (occ)
+				{
+					materialValue += see::value(boards.pieceAt(occ.popLowestSquare()));
+				}
+
+				++material[std::min<usize>(materialValue / MaterialBucketWidth, MaterialBuckets - 1)];
+
+				if (std::abs(eval) > ScoreWin)
+					++mateScores;
+				else
+				{
+					static constexpr auto Half = static_cast<i32>(EvalBuckets / 2);
+
+					const auto floored = eval >= 0
+						? eval / EvalBucketWidth
+						: -((-eval + EvalBucketWidth - 1) / EvalBucketWidth);
+
+					const auto bucket = std::clamp(floored, -Half, Half - 1);
+					++evals[bucket + Half];
+				}
+
+				if (pos.isBareKingWin())
+					++bareKingPositions;
+			}
+
+			auto merge(const Analysis &other)
+			{
+				const auto add = [](auto &dst, const auto &src)
+				{
+					for (usize i = 0; i < dst.size(); ++i)
+					{
+						dst[i] += src[i];
+					}
+				};
+
+				records += other.records;
+				invalid += other.invalid;
+
+				positions += other.positions;
+				add(positionOutcomes, other.positionOutcomes);
+				add(material, other.material);
+				add(evals, other.evals);
+				mateScores += other.mateScores;
+				add(pieceCounts, other.pieceCounts);
+				bareKingPositions += other.bareKingPositions;
+
+				games += other.games;
+				add(gameOutcomes, other.gameOutcomes);
+				add(gameLengths, other.gameLengths);
+				bareKingGames += other.bareKingGames;
+			}
+		};
+
+		auto analyzeRecord(RecordFormat format, std::span<const u8> record, Position &pos, Analysis &analysis)
+		{
+			++analysis.records;
+
+			marlinformat::PackedBoard board{};
+			std::memcpy(&board, record.data(), PackedBoardSize);
+
+			if (!board.unpack(pos) || static_cast<u8>(board.wdl) > static_cast<u8>(Outcome::WhiteWin))
+			{
+				++analysis.invalid;
+				return;
+			}
+
+			if (format == RecordFormat::Marlinformat)
+			{
+				analysis.addPosition(pos, board.eval, board.wdl);
+				return;
+			}
+
+			usize plies{};
+
+			for (usize offset = PackedBoardSize; offset + ViriformatMoveSize < record.size(); offset += ViriformatMoveSize)
+			{
+				u16 packedMove;
+				i16 score;
+
+				std::memcpy(&packedMove, &record[offset], sizeof(u16));
+				std::memcpy(&score, &record[offset + sizeof(u16)], sizeof(i16));
+
+				const auto move = viriformat::unpackMove(packedMove);
+
+				if (!pos.isPseudolegal(move) || !pos.isLegal(move))
+				{
+					++analysis.invalid;
+					return;
+				}
+
+				analysis.addPosition(pos, score, board.wdl);
+				pos.applyMoveUnchecked<false, false>(move, nullptr);
+
+				++plies;
+			}
+
+			++analysis.games;
+			++analysis.gameOutcomes[static_cast<i32>(board.wdl)];
+			++analysis.gameLengths[std::min(plies / GameLengthBucketWidth, GameLengthBuckets - 1)];
+
+			if (pos.isBareKingWin())
+				++analysis.bareKingGames;
+		}
+
+		auto printCounts(const std::string &title, std::span<const usize> counts,
+			usize total, const auto &label)
+		{
+			std::cout << title << ":" << std::endl;
+
+			for (usize i = 0; i < counts.size(); ++i)
+			{
+				const auto percent = total == 0 ? 0.0 : 100.0 * static_cast<f64>(counts[i]) / static_cast<f64>(total);
+
+				std::cout << "  " << std::left << std::setw(12) << label(i) << std::right
+					<< std::setw(14) << counts[i] << "  " << std::setw(6) << percent << "%" << std::endl;
+			}
+		}
+
+		auto printAnalysis(RecordFormat format, const Analysis &analysis)
+		{
+			static constexpr auto OutcomeNames = std::array{"loss", "draw", "win"};
+
+			const auto range = [](auto lo, auto width, usize i, usize count)
+			{
+				const auto start = lo + static_cast<decltype(lo)>(i) * width;
+				const auto end = start + width - 1;
+
+				if (i + 1 == count)
+					return ">= " + std::to_string(start);
+
+				return std::to_string(start) + ".." + std::to_string(end);
+			};
+
+			std::cout << std::fixed << std::setprecision(2);
+
+			std::cout << "records: " << analysis.records << " (" << analysis.invalid << " invalid)" << std::endl;
+			std::cout << "positions: " << analysis.positions << std::endl;
+
+			printCounts("position outcomes (white relative)", analysis.positionOutcomes, analysis.positions,
+				[&](usize i) { return OutcomeNames[i]; });
+
+			printCounts("material (see values, both sides)", analysis.material, analysis.positions,
+				[&](usize i) { return range(0, MaterialBucketWidth, i, MaterialBuckets); });
+
+			printCounts("eval (white relative)", analysis.evals, analysis.positions, [&](usize i)
+			{
+				static constexpr auto Lo = -static_cast<Score>(EvalBuckets / 2) * EvalBucketWidth;
+
+				if (i == 0)
+					return "< " + std::to_string(Lo + EvalBucketWidth);
+
+				return range(Lo, EvalBucketWidth, i, EvalBuckets);
+			});
+
+			std::cout << "  mate scores  " << std::setw(13) << analysis.mateScores << std::endl;
+
+			// no position has fewer than two kings
+			printCounts("piece count", std::span{analysis.pieceCounts}.subspan(2), analysis.positions,
+				[&](usize i) { return std::to_string(i + 2); });
+
+			std::cout << "bare king win positions: " << analysis.bareKingPositions << std::endl;
+
+			if (format == RecordFormat::Viriformat)
+			{
+				std::cout << "games: " << analysis.games << std::endl;
+
+				printCounts("game outcomes (white relative)", analysis.gameOutcomes, analysis.games,
+					[&](usize i) { return OutcomeNames[i]; });
+
+				printCounts("game length (plies)", analysis.gameLengths, analysis.games,
+					[&](usize i) { return range(usize{0}, GameLengthBucketWidth, i, GameLengthBuckets); });
+
+				std::cout << "games ending in a bare king win: " << analysis.bareKingGames << std::endl;
+			}
+
+			std::cout << std::defaultfloat;
+		}
+
+		enum class BucketMode
+		{
+			Shuffle,
+			Dedupe,
+		};
+
+		auto runBucketed(BucketMode mode, const std::string &formatName, const std::string &input,
+			const std::string &output, const ToolOptions &options) -> i32
+		{
+			const auto format = parseFormat(formatName);
+			if (!format)
+				return 1;
+
+			std::error_code error{};
+
+			const auto inputSize = std::filesystem::file_size(input, error);
+			if (error)
+			{
+				std::cerr << "failed to get size of " << input << ": " << error.message() << std::endl;
+				return 1;
+			}
+
+			const auto start = util::Instant::now();
+
+			const auto threadCount = std::max<u32>(options.threads, 1);
+			const auto memory = std::max<usize>(options.memoryMib, 1) * 1024 * 1024;
+
+			const auto maxBucketSize = std::max<usize>(memory / threadCount / BucketMemoryFactor, 1);
+			const auto bucketCount = std::max<usize>((inputSize + maxBucketSize - 1) / maxBucketSize, 1);
+
+			const auto bucketBufferSize = std::clamp(memory / 2 / bucketCount, MinBucketBufferSize, MaxBucketBufferSize);
+
+			const auto seed = options.seed.value_or(util::rng::generateSingleSeed());
+
+			if (mode == BucketMode::Shuffle)
+				std::cout << "seed: " << seed << std::endl;
+
+			std::cout << "using " << bucketCount << " bucket" << (bucketCount == 1 ? "" : "s")
+				<< " and " << threadCount << " thread" << (threadCount == 1 ? "" : "s") << std::endl;
+
+			const std::filesystem::path tempDir{output + ".tmp"};
+
+			std::filesystem::create_directories(tempDir, error);
+			if (error)
+			{
+				std::cerr << "failed to create " << tempDir << ": " << error.message() << std::endl;
+				return 1;
+			}
+
+			const auto result = [&]() -> i32
+			{
+				util::rng::SeedGenerator seedGenerator{seed};
+				util::rng::Jsf64Rng rng{seedGenerator.nextSeed()};
+
+				BucketWriter buckets{tempDir, bucketCount, bucketBufferSize};
+
+				usize inputRecords{};
+
+				{
+					BufferedInput in{input};
+					if (!in.ok())
+						return 1;
+
+					std::vector<u8> record{};
+					ReadResult readResult;
+
+					while ((readResult = in.read(*format, record)) == ReadResult::Ok)
+					{
+						const auto bucket = mode == BucketMode::Shuffle
+							? rng.nextU32(static_cast<u32>(bucketCount))
+							: recordKey(*format, record) % bucketCount;
+
+						if (!buckets.push(bucket, record))
+							return 1;
+
+						++inputRecords;
+					}
+
+					if (readResult == ReadResult::Truncated)
+						std::cerr << "warning: " << input << " ends with a truncated record, ignoring" << std::endl;
+
+					if (!buckets.finish())
+						return 1;
+				}
+
+				std::cout << "pass 1: " << inputRecords << " records, ";
+				printRate(util::Instant::now().elapsedSince(start), inputSize);
+
+				// generated up front, so that each bucket's shuffle does not depend on scheduling
+				std::vector<u64> bucketSeeds(bucketCount);
+				std::ranges::generate(bucketSeeds, [&] { return seedGenerator.nextSeed(); });
+
+				std::atomic<usize> outputRecords{0};
+
+				BufferedOutput out{output};
+				if (!out.ok())
+					return 1;
+
+				const auto shuffleBucket = [&](usize bucket, std::span<const u8> data,
+					std::span<const usize> offsets, std::vector<u8> &dst)
+				{
+					util::rng::Jsf64Rng bucketRng{bucketSeeds[bucket]};
+
+					std::vector<usize> order(offsets.size());
+					for (usize i = 0; i < order.size(); ++i)
+					{
+						order[i] = i;
+					}
+
+					std::ranges::shuffle(order, bucketRng);
+
+					for (const auto idx : order)
+					{
+						const auto record = recordBytes(data, offsets, idx);
+						dst.insert(dst.end(), record.begin(), record.end());
+					}
+
+					outputRecords.fetch_add(order.size(), std::memory_order::relaxed);
+				};
+
+				const auto dedupeBucket = [&](usize bucket, std::span<const u8> data,
+					std::span<const usize> offsets, std::vector<u8> &dst)
+				{
+					std::vector<std::pair<u64, usize>> keys{};
+					keys.reserve(offsets.size());
+
+					for (usize i = 0; i < offsets.size(); ++i)
+					{
+						keys.emplace_back(recordKey(*format, recordBytes(data, offsets, i)), i);
+					}
+
+					// the first occurrence of each key sorts first
+					std::ranges::sort(keys);
+
+					std::vector<bool> keep(offsets.size());
+
+					for (usize i = 0; i < keys.size(); ++i)
+					{
+						if (i == 0 || keys[i].first != keys[i - 1].first)
+							keep[keys[i].second] = true;
+					}
+
+					usize kept{};
+
+					for (usize i = 0; i < offsets.size(); ++i)
+					{
+						if (!keep[i])
+							continue;
+
+						const auto record = recordBytes(data, offsets, i);
+						dst.insert(dst.end(), record.begin(), record.end());
+
+						++kept;
+					}
+
+					outputRecords.fetch_add(kept, std::memory_order::relaxed);
+				};
+
+				const auto processed = mode == BucketMode::Shuffle
+					? processBuckets(*format, buckets, threadCount, out, shuffleBucket)
+					: processBuckets(*format, buckets, threadCount, out, dedupeBucket);
+
+				if (!processed)
+					return 1;
+
+				if (!out.close())
+				{
+					std::cerr << "failed to write " << output << std::endl;
+					return 1;
+				}
+
+				std::cout << "pass 2: " << outputRecords.load() << " records";
+				if (mode == BucketMode::Dedupe)
+					std::cout << " (" << (inputRecords - outputRecords.load()) << " duplicates removed)";
+				std::cout << ", ";
+
+				printRate(util::Instant::now().elapsedSince(start), out.bytes());
+
+				return 0;
+			}();
+
+			std::filesystem::remove_all(tempDir, error);
+
+			return result;
+		}
+	}
+
+	auto shuffle(const std::string &format, const std::string &input,
+		const std::string &output, const ToolOptions &options) -> i32
+	{
+		return runBucketed(BucketMode::Shuffle, format, input, output, options);
+	}
+
+	auto dedupe(const std::string &format, const std::string &input,
+		const std::string &output, const ToolOptions &options) -> i32
+	{
+		return runBucketed(BucketMode::Dedupe, format, input, output, options);
+	}
+
+	auto interleave(const std::string &formatName, std::span<const std::string> inputs,
+		const std::string &output, const ToolOptions &options) -> i32
+	{
+		const auto format = parseFormat(formatName);
+		if (!format)
+			return 1;
+
+		struct Input
+		{
+			std::string path;
+			std::unique_ptr<BufferedInput> file;
+			usize remaining;
+		};
+
+		std::vector<Input> files{};
+		files.reserve(inputs.size());
+
+		usize totalRemaining{};
+
+		for (const auto &path : inputs)
+		{
+			std::error_code error{};
+
+			const auto size = std::filesystem::file_size(path, error);
+			if (error)
+			{
+				std::cerr << "failed to get size of " << path << ": " << error.message() << std::endl;
+				return 1;
+			}
+
+			auto file = std::make_unique<BufferedInput>(path);
+			if (!file->ok())
+				return 1;
+
+			files.push_back({path, std::move(file), size});
+			totalRemaining += size;
+		}
+
+		const auto seed = options.seed.value_or(util::rng::generateSingleSeed());
+		std::cout << "seed: " << seed << std::endl;
+
+		util::rng::Jsf64Rng rng{util::rng::SeedGenerator{seed}.nextSeed()};
+
+		BufferedOutput out{output};
+		if (!out.ok())
+			return 1;
+
+		const auto start = util::Instant::now();
+
+		std::vector<u8> record{};
+		usize records{};
+
+		while (totalRemaining > 0)
+		{
+			// lemire's multiply-shift, as in Jsf64Rng::nextU32(bound)
+			auto target = static_cast<usize>((static_cast<u128>(rng.nextU64()) * totalRemaining) >> 64);
+
+			auto &file = *std::ranges::find_if(files, [&](const Input &input)
+			{
+				if (target < input.remaining)
+					return true;
+				target -= input.remaining;
+				return false;
+			});
+
+			const auto readResult = file.file->read(*format, record);
+
+			if (readResult != ReadResult::Ok)
+			{
+				if (readResult == ReadResult::Truncated)
+					std::cerr << "warning: " << file.path << " ends with a truncated record, ignoring" << std::endl;
+
+				totalRemaining -= file.remaining;
+				file.remaining = 0;
+
+				continue;
+			}
+
+			out.write(record);
+			++records;
+
+			const auto consumed = std::min(file.remaining, record.size());
+
+			file.remaining -= consumed;
+			totalRemaining -= consumed;
+		}
+
+		if (!out.close())
+		{
+			std::cerr << "failed to write " << output << std::endl;
+			return 1;
+		}
+
+		std::cout << records << " records from " << inputs.size() << " files, ";
+		printRate(util::Instant::now().elapsedSince(start), out.bytes());
+
+		return 0;
+	}
+
+	auto analyze(const std::string &formatName, const std::string &path, const ToolOptions &options) -> i32
+	{
+		const auto format = parseFormat(formatName);
+		if (!format)
+			return 1;
+
+		const auto file = util::MappedFile::open(path);
+		if (!file)
+		{
+			std::cerr << "failed to open " << path << std::endl;
+			return 1;
+		}
+
+		const auto start = util::Instant::now();
+
+		const auto data = std::span<const u8>{reinterpret_cast<const u8 *>(file->data().data()), file->data().size()};
+
+		const auto threadCount = std::max<u32>(options.threads, 1);
+		const auto targetChunkSize = std::max<usize>(data.size() / (threadCount * AnalysisChunksPerThread), 1);
+
+		// chunk boundaries must fall between records, which
+		// for viriformat means walking the file once up front
+		std::vector<usize> boundaries{0};
+		usize end{};
+
+		while (end < data.size())
+		{
+			const auto size = recordSize(*format, data, end);
+
+			if (size == 0)
+			{
+				std::cerr << "warning: " << path << " ends with a truncated record, ignoring" << std::endl;
+				break;
+			}
+
+			end += size;
+
+			if (end - boundaries.back() >= targetChunkSize)
+				boundaries.push_back(end);
+		}
+
+		if (boundaries.back() != end)
+			boundaries.push_back(end);
+
+		const auto chunks = boundaries.size() - 1;
+
+		std::vector<Analysis> results(threadCount);
+		std::atomic<usize> nextChunk{0};
+
+		const auto worker = [&](Analysis &analysis)
+		{
+			Position pos{};
+
+			while (true)
+			{
+				const auto chunk = nextChunk.fetch_add(1, std::memory_order::relaxed);
+				if (chunk >= chunks)
+					break;
+
+				for (auto offset = boundaries[chunk]; offset < boundaries[chunk + 1];)
+				{
+					const auto size = recordSize(*format, data, offset);
+					analyzeRecord(*format, data.subspan(offset, size), pos, analysis);
+					offset += size;
+				}
+			}
+		};
+
+		std::vector<std::thread> threads{};
+		threads.reserve(threadCount);
+
+		for (u32 i = 0; i < threadCount; ++i)
+		{
+			threads.emplace_back(worker, std::ref(results[i]));
+		}
+
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+
+		Analysis total{};
+
+		for (const auto &result : results)
+		{
+			total.merge(result);
+		}
+
+		printAnalysis(*format, total);
+
+		std::cout << "analysed ";
+		printRate(util::Instant::now().elapsedSince(start), end);
+
+		return 0;
+	}
+
+	auto split(const std::string &formatName, const std::string &input, const std::string &trainOutput,
+		const std::string &validationOutput, f64 validationFraction) -> i32
+	{
+		const auto format = parseFormat(formatName);
+		if (!format)
+			return 1;
+
+		if (!(validationFraction >= 0.0 && validationFraction <= 1.0))
+		{
+			std::cerr << "validation fraction must be between 0 and 1" << std::endl;
+			return 1;
+		}
+
+		// keys are uniformly distributed, so comparing against a
+		// threshold picks the requested fraction of distinct records
+		const auto threshold = validationFraction >= 1.0
+			? std::numeric_limits<u64>::max()
+			: static_cast<u64>(std::ldexp(validationFraction, 64));
+
+		BufferedInput in{input};
+		if (!in.ok())
+			return 1;
+
+		BufferedOutput train{trainOutput};
+		BufferedOutput validation{validationOutput};
+
+		if (!train.ok() || !validation.ok())
+			return 1;
+
+		const auto start = util::Instant::now();
+
+		std::vector<u8> record{};
+		ReadResult readResult;
+
+		usize trainRecords{};
+		usize validationRecords{};
+
+		while ((readResult = in.read(*format, record)) == ReadResult::Ok)
+		{
+			if (recordKey(*format, record) < threshold)
+			{
+				validation.write(record);
+				++validationRecords;
+			}
+			else
+			{
+				train.write(record);
+				++trainRecords;
+			}
+		}
+
+		if (readResult == ReadResult::Truncated)
+			std::cerr << "warning: " << input << " ends with a truncated record, ignoring" << std::endl;
+
+		if (!train.close())
+		{
+			std::cerr << "failed to write " << trainOutput << std::endl;
+			return 1;
+		}
+
+		if (!validation.close())
+		{
+			std::cerr << "failed to write " << validationOutput << std::endl;
+			return 1;
+		}
+
+		std::cout << trainRecords << " training records, " << validationRecords << " validation records, ";
+		printRate(util::Instant::now().elapsedSince(start), train.bytes() + validation.bytes());
+
+		return 0;
+	}
+}
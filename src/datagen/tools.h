@@ -0,0 +1,70 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <optional>
+#include <span>
+#include <string>
+
+namespace oranj::datagen::tools
+{
+	constexpr usize DefaultToolMemoryMib = 4096;
+
+	struct ToolOptions
+	{
+		u32 threads{1};
+		// approximate upper bound on the memory held by all threads at once
+		usize memoryMib{DefaultToolMemoryMib};
+		// random if not given
+		std::optional<u64> seed{};
+	};
+
+	// All tools stream their inputs through large buffers and accept
+	// marlinformat and viriformat files. A record is one position for
+	// marlinformat, and one complete game for viriformat.
+
+	// External shuffle. Records are scattered into temporary bucket files
+	// next to the output, which are then shuffled in memory in parallel.
+	auto shuffle(const std::string &format, const std::string &input,
+		const std::string &output, const ToolOptions &options) -> i32;
+
+	// Removes all but the first occurrence of each record, keyed on the position
+	// in the packed board (and the moves played, for viriformat). Records are
+	// partitioned by key into temporary bucket files, so the output is grouped
+	// by bucket rather than in input order. Shuffle afterwards.
+	auto dedupe(const std::string &format, const std::string &input,
+		const std::string &output, const ToolOptions &options) -> i32;
+
+	// Merges the inputs into one file, drawing each record from an input chosen
+	// at random with probability proportional to the data it has left.
+	auto interleave(const std::string &format, std::span<const std::string> inputs,
+		const std::string &output, const ToolOptions &options) -> i32;
+
+	// Reports counts by material phase, outcome, eval, piece count, game
+	// length and bare king wins, to validate a corpus before training on it.
+	// The file is memory mapped and divided between threads.
+	auto analyze(const std::string &format, const std::string &path, const ToolOptions &options) -> i32;
+
+	// Divides the input into training and validation sets. The split is decided
+	// by record key, so duplicates of a record always end up in the same set.
+	auto split(const std::string &format, const std::string &input, const std::string &trainOutput,
+		const std::string &validationOutput, f64 validationFraction) -> i32;
+}
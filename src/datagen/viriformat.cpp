@@ -22,6 +22,79 @@
 
 namespace oranj::datagen
 {
+	namespace viriformat
+	{
+		namespace
+		{
+			using ScoredMove = std::pair<u16, i16>;
+			static_assert(sizeof(ScoredMove) == sizeof(u16) + sizeof(i16));
+
+			constexpr auto MoveTypes = std::array{
+				static_cast<u16>(0x0000), // normal
+				static_cast<u16>(0xC000), // promo
+			};
+
+			constexpr u16 MoveTypeMask = 0xC000;
+		}
+
+		auto packMove(Move move) -> u16
+		{
+			u16 viriMove{};
+
+			viriMove |= move.srcIdx();
+			viriMove |= move.dstIdx() << 6;
+			viriMove |= MoveTypes[static_cast<i32>(move.type())];
+
+			return viriMove;
+		}
+
+		auto unpackMove(u16 move) -> Move
+		{
+			const auto src = static_cast<Square>(move & 0x3F);
+			const auto dst = static_cast<Square>((move >> 6) & 0x3F);
+
+			return (move & MoveTypeMask) == MoveTypes[static_cast<i32>(MoveType::Promotion)]
+				? Move::promotion(src, dst)
+				: Move::standard(src, dst);
+		}
+
+		auto readGame(std::istream &stream, Game &game) -> bool
+		{
+			game.moves.clear();
+
+			if (!stream.read(reinterpret_cast<char *>(&game.initial), sizeof(marlinformat::PackedBoard)))
+				return false;
+
+			while (true)
+			{
+				ScoredMove move{};
+
+				if (!stream.read(reinterpret_cast<char *>(&move), sizeof(ScoredMove)))
+					return false;
+
+				if (move.first == 0 && move.second == 0)
+					return true;
+
+				game.moves.emplace_back(unpackMove(move.first), move.second);
+			}
+		}
+
+		auto writeGame(std::ostream &stream, const Game &game) -> void
+		{
+			static constexpr std::array<u8, sizeof(ScoredMove)> NullTerminator{};
+
+			stream.write(reinterpret_cast<const char *>(&game.initial), sizeof(marlinformat::PackedBoard));
+
+			for (const auto [move, score] : game.moves)
+			{
+				const ScoredMove packed{packMove(move), score};
+				stream.write(reinterpret_cast<const char *>(&packed), sizeof(ScoredMove));
+			}
+
+			stream.write(reinterpret_cast<const char *>(NullTerminator.data()), sizeof(ScoredMove));
+		}
+	}
+
 	Viriformat::Viriformat()
 	{
 		m_moves.reserve(256);
@@ -35,18 +108,7 @@ namespace oranj::datagen
 
 	auto Viriformat::push([[maybe_unused]] bool filtered, Move move, Score score) -> void
 	{
-		static constexpr auto MoveTypes = std::array{
-			static_cast<u16>(0x0000), // normal
-			static_cast<u16>(0xC000), // promo
-		};
-
-		u16 viriMove{};
-
-		viriMove |= move.srcIdx();
-		viriMove |= move.dstIdx() << 6;
-		viriMove |= MoveTypes[static_cast<i32>(move.type())];
-
-		m_moves.push_back({viriMove, static_cast<i16>(score)});
+		m_moves.push_back({viriformat::packMove(move), static_cast<i16>(score)});
 	}
 
 	auto Viriformat::writeAllWithOutcome(std::ostream &stream, Outcome outcome) -> usize
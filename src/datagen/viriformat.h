@@ -20,12 +20,34 @@
 
 #include "../types.h"
 
+#include <vector>
+#include <utility>
+#include <istream>
+#include <ostream>
+
 #include "common.h"
 #include "format.h"
 #include "marlinformat.h"
 
 namespace oranj::datagen
 {
+	namespace viriformat
+	{
+		struct Game
+		{
+			// wdl holds the outcome, eval is unused
+			marlinformat::PackedBoard initial{};
+			std::vector<std::pair<Move, i16>> moves{};
+		};
+
+		[[nodiscard]] auto packMove(Move move) -> u16;
+		[[nodiscard]] auto unpackMove(u16 move) -> Move;
+
+		// false at the end of the stream, or if the game is truncated
+		auto readGame(std::istream &stream, Game &game) -> bool;
+		auto writeGame(std::ostream &stream, const Game &game) -> void;
+	}
+
 	// Format originally from Viridithas
 	// https://github.com/cosmobobak/viridithas/blob/029672a/src/datagen/dataformat.rs
 	class Viriformat
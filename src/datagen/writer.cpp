@@ -0,0 +1,586 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "writer.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
+
+#include "../util/align.h"
+
+namespace oranj::datagen
+{
+	// Appends to a file through a large aligned staging buffer, so the
+	// filesystem sees a few big writes instead of one small write per game
+	class OutputFile
+	{
+	public:
+		~OutputFile()
+		{
+			close();
+			util::alignedFree(m_buffer);
+		}
+
+		// if truncateTo is set, the file is cut back to that size first
+		[[nodiscard]] static auto open(const std::filesystem::path &path,
+			bool directIo, std::optional<u64> truncateTo) -> std::unique_ptr<OutputFile>
+		{
+			if (truncateTo)
+			{
+				std::error_code error{};
+				const auto size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+
+				if (error || size < *truncateTo)
+				{
+					std::cerr << path << " is shorter than its checkpoint (" << size
+						<< " < " << *truncateTo << " bytes)" << std::endl;
+					return nullptr;
+				}
+
+				if (size > *truncateTo)
+				{
+					std::filesystem::resize_file(path, *truncateTo, error);
+
+					if (error)
+					{
+						std::cerr << "failed to truncate " << path << ": " << error.message() << std::endl;
+						return nullptr;
+					}
+
+					std::cout << "discarded " << (size - *truncateTo) << " bytes after the last checkpoint in "
+						<< path << std::endl;
+				}
+			}
+
+			std::unique_ptr<OutputFile> file{new OutputFile{}};
+
+			file->m_buffer = util::alignedAlloc<u8>(Alignment, BufferSize);
+
+			if (!file->m_buffer)
+				return nullptr;
+
+#ifdef __linux__
+			const auto pathStr = path.string();
+
+			file->m_fd = ::open(pathStr.c_str(), O_WRONLY | O_CREAT, 0644);
+
+			if (file->m_fd < 0)
+				return nullptr;
+
+			const auto end = ::lseek(file->m_fd, 0, SEEK_END);
+
+			if (end < 0)
+				return nullptr;
+
+			file->m_baseOffset = static_cast<u64>(end);
+
+			if (directIo)
+			{
+				// direct writes must start at an aligned offset
+				if (end % Alignment != 0)
+					std::cerr << "not using direct io for " << path
+						<< ": existing file size is not a multiple of " << Alignment << std::endl;
+				else if (const auto flags = ::fcntl(file->m_fd, F_GETFL);
+					flags < 0 || ::fcntl(file->m_fd, F_SETFL, flags | O_DIRECT) < 0)
+					std::cerr << "not using direct io for " << path
+						<< ": " << std::strerror(errno) << std::endl;
+				else file->m_direct = true;
+			}
+#else
+			if (directIo)
+				std::cerr << "direct io is not supported on this platform" << std::endl;
+
+			file->m_file = std::fopen(path.string().c_str(), "ab");
+
+			if (!file->m_file)
+				return nullptr;
+
+			std::setvbuf(file->m_file, nullptr, _IONBF, 0);
+
+			std::error_code error{};
+			file->m_baseOffset = std::filesystem::file_size(path, error);
+#endif
+
+			return file;
+		}
+
+		// counts bytes, but never writes them anywhere
+		[[nodiscard]] static auto discard() -> std::unique_ptr<OutputFile>
+		{
+			std::unique_ptr<OutputFile> file{new OutputFile{}};
+
+			file->m_buffer = util::alignedAlloc<u8>(Alignment, BufferSize);
+			file->m_discard = true;
+
+			return file->m_buffer ? std::move(file) : nullptr;
+		}
+
+		auto write(const u8 *data, usize size) -> bool
+		{
+			while (size > 0)
+			{
+				const auto count = std::min(size, BufferSize - m_used);
+
+				std::memcpy(m_buffer + m_used, data, count);
+
+				m_used += count;
+				data += count;
+				size -= count;
+
+				if (m_used == BufferSize && !writeOut(m_used))
+					return false;
+			}
+
+			return true;
+		}
+
+		// writes out as much of the staging buffer as possible without
+		// breaking direct io alignment, and syncs the file to disk
+		auto sync() -> bool
+		{
+			if (m_discard)
+				return writeOut(m_used);
+
+			if (!writeOut(m_direct ? m_used - m_used % Alignment : m_used))
+				return false;
+
+#ifdef __linux__
+			return ::fsync(m_fd) == 0;
+#elif defined(_WIN32)
+			return _commit(_fileno(m_file)) == 0;
+#else
+			return true;
+#endif
+		}
+
+		auto close() -> bool
+		{
+			if (m_discard)
+				return writeOut(m_used);
+
+			bool success = true;
+
+#ifdef __linux__
+			if (m_fd < 0)
+				return true;
+
+			// the tail is almost never aligned
+			if (m_direct && m_used % Alignment != 0)
+			{
+				if (const auto flags = ::fcntl(m_fd, F_GETFL); flags >= 0)
+					::fcntl(m_fd, F_SETFL, flags & ~O_DIRECT);
+				m_direct = false;
+			}
+
+			success = writeOut(m_used) && ::fsync(m_fd) == 0;
+
+			::close(m_fd);
+			m_fd = -1;
+#else
+			if (!m_file)
+				return true;
+
+			success = sync();
+
+			std::fclose(m_file);
+			m_file = nullptr;
+#endif
+
+			return success;
+		}
+
+		// offset in the file up to which everything has been written
+		[[nodiscard]] inline auto offset() const
+		{
+			return m_baseOffset + m_flushed;
+		}
+
+		[[nodiscard]] inline auto bytesFlushed() const
+		{
+			return m_flushed;
+		}
+
+	private:
+		static constexpr usize Alignment = 4096;
+		static constexpr usize BufferSize = 4 * 1024 * 1024;
+
+		static_assert(BufferSize % Alignment == 0);
+
+		OutputFile() = default;
+
+		u8 *m_buffer{};
+		usize m_used{};
+
+		u64 m_baseOffset{};
+		usize m_flushed{};
+
+		bool m_discard{false};
+
+#ifdef __linux__
+		i32 m_fd{-1};
+		bool m_direct{false};
+#else
+		std::FILE *m_file{};
+		static constexpr bool m_direct = false;
+#endif
+
+		// writes the first size bytes of the staging buffer, moving any rest to the front
+		auto writeOut(usize size) -> bool
+		{
+			const auto *data = m_buffer;
+			auto remaining = m_discard ? 0 : size;
+
+			while (remaining > 0)
+			{
+#ifdef __linux__
+				const auto written = ::write(m_fd, data, remaining);
+
+				if (written < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					std::cerr << "failed to write datagen output: " << std::strerror(errno) << std::endl;
+					return false;
+				}
+
+				const auto count = static_cast<usize>(written);
+#else
+				const auto count = std::fwrite(data, 1, remaining, m_file);
+
+				if (count == 0)
+				{
+					std::cerr << "failed to write datagen output" << std::endl;
+					return false;
+				}
+#endif
+
+				data += count;
+				remaining -= count;
+			}
+
+			if (size < m_used)
+				std::memmove(m_buffer, m_buffer + size, m_used - size);
+
+			m_flushed += size;
+			m_used -= size;
+
+			return true;
+		}
+	};
+
+	WriterChannel::WriterChannel(AsyncWriter &writer, std::unique_ptr<OutputFile> file, const Checkpoint &initial)
+		: m_writer{writer},
+		  m_file{std::move(file)},
+		  m_baseOffset{initial.offset},
+		  m_durable{initial}
+	{
+		m_current.data.reserve(BlockSize + BlockSize / 4);
+	}
+
+	WriterChannel::~WriterChannel() = default;
+
+	auto WriterChannel::checkpoint(Checkpoint checkpoint) -> void
+	{
+		checkpoint.offset = m_baseOffset + bytesWritten();
+		m_current.checkpoint = checkpoint;
+	}
+
+	auto WriterChannel::commit() -> void
+	{
+		if (m_current.data.size() >= BlockSize || m_blockStart.elapsed() >= MaxBlockAge)
+			submit();
+	}
+
+	auto WriterChannel::close() -> void
+	{
+		if (!m_current.data.empty() || m_current.checkpoint)
+			submit();
+
+		m_closed.store(true, std::memory_order::release);
+		m_writer.notify();
+	}
+
+	auto WriterChannel::submit() -> void
+	{
+		const auto tail = m_tail.load(std::memory_order::relaxed);
+
+		if (tail - m_head.load(std::memory_order::acquire) == Capacity)
+		{
+			++m_stalls;
+
+			while (tail - m_head.load(std::memory_order::acquire) == Capacity)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		m_bytesSubmitted += m_current.data.size();
+
+		// the slot holds an already drained (empty) block, so the
+		// worker gets its allocation back for the next one
+		std::swap(m_current, m_slots[tail % Capacity]);
+		m_blockStart = util::Instant::now();
+
+		m_tail.store(tail + 1, std::memory_order::release);
+		m_writer.notify();
+	}
+
+	auto WriterChannel::drainOne() -> bool
+	{
+		const auto head = m_head.load(std::memory_order::relaxed);
+
+		if (head == m_tail.load(std::memory_order::acquire))
+			return false;
+
+		auto &block = m_slots[head % Capacity];
+
+		// once failed, blocks are still drained so the worker never waits on
+		// a full ring, but they are thrown away and their checkpoints with them
+		if (!m_failed)
+		{
+			if (m_file->write(block.data.data(), block.data.size()))
+			{
+				if (block.checkpoint)
+					m_unflushed.push_back(*block.checkpoint);
+			}
+			else fail();
+		}
+
+		block.data.clear();
+		block.checkpoint.reset();
+
+		m_head.store(head + 1, std::memory_order::release);
+
+		return true;
+	}
+
+	auto WriterChannel::updateDurable() -> void
+	{
+		if (m_failed)
+			return;
+
+		while (!m_unflushed.empty() && m_unflushed.front().offset <= m_file->offset())
+		{
+			m_durable = m_unflushed.front();
+			m_unflushed.pop_front();
+		}
+	}
+
+	auto WriterChannel::fail() -> void
+	{
+		if (m_failed)
+			return;
+
+		m_failed = true;
+		m_unflushed.clear();
+
+		m_writer.fail();
+	}
+
+	AsyncWriter::AsyncWriter(bool directIo, CheckpointCallback onCheckpoint, FailureCallback onFailure)
+		: m_directIo{directIo},
+		  m_onCheckpoint{std::move(onCheckpoint)},
+		  m_onFailure{std::move(onFailure)} {}
+
+	AsyncWriter::~AsyncWriter()
+	{
+		if (m_thread.joinable())
+			finish();
+	}
+
+	auto AsyncWriter::open(const std::filesystem::path &path, Checkpoint initial, bool truncate) -> WriterChannel *
+	{
+		assert(!m_thread.joinable());
+
+		auto file = OutputFile::open(path, m_directIo,
+			truncate ? std::optional{initial.offset} : std::nullopt);
+
+		if (!file)
+		{
+			std::cerr << "failed to open output file " << path << std::endl;
+			return nullptr;
+		}
+
+		initial.offset = file->offset();
+
+		return m_channels.emplace_back(std::make_unique<WriterChannel>(*this, std::move(file), initial)).get();
+	}
+
+	auto AsyncWriter::openDiscarding(Checkpoint initial) -> WriterChannel *
+	{
+		assert(!m_thread.joinable());
+
+		auto file = OutputFile::discard();
+
+		if (!file)
+			return nullptr;
+
+		initial.offset = 0;
+
+		return m_channels.emplace_back(std::make_unique<WriterChannel>(*this, std::move(file), initial)).get();
+	}
+
+	auto AsyncWriter::start() -> void
+	{
+		// so that even a run killed before its first checkpoint can be resumed
+		checkpoint();
+
+		m_startTime = util::Instant::now();
+		m_thread = std::thread{[this] { run(); }};
+	}
+
+	auto AsyncWriter::finish() -> bool
+	{
+		m_thread.join();
+
+		usize totalBytes{};
+		usize totalStalls{};
+
+		for (auto &channel : m_channels)
+		{
+			if (!channel->m_failed && !channel->m_file->close())
+				channel->fail();
+
+			channel->updateDurable();
+
+			totalBytes += channel->m_file->bytesFlushed();
+			totalStalls += channel->stalls();
+		}
+
+		checkpoint();
+
+		const auto time = m_startTime.elapsed();
+
+		std::cout << "writer: wrote " << totalBytes << " bytes in " << time << " sec ("
+			<< (static_cast<f64>(totalBytes) / (1024.0 * 1024.0) / time) << " MiB/sec), workers stalled "
+			<< totalStalls << " times" << std::endl;
+
+		return !m_failed;
+	}
+
+	auto AsyncWriter::notify() -> void
+	{
+		{
+			const std::unique_lock lock{m_mutex};
+			++m_generation;
+		}
+
+		m_signal.notify_one();
+	}
+
+	auto AsyncWriter::fail() -> void
+	{
+		if (m_failed)
+			return;
+
+		m_failed = true;
+
+		std::cerr << "writer: failed to write datagen output, stopping. "
+			"the manifest is kept at the last checkpoint that reached disk" << std::endl;
+
+		m_onFailure();
+	}
+
+	auto AsyncWriter::checkpoint() -> void
+	{
+		std::vector<Checkpoint> checkpoints{};
+		checkpoints.reserve(m_channels.size());
+
+		for (const auto &channel : m_channels)
+		{
+			checkpoints.push_back(channel->m_durable);
+		}
+
+		m_onCheckpoint(checkpoints);
+	}
+
+	auto AsyncWriter::run() -> void
+	{
+		auto lastCheckpoint = util::Instant::now();
+
+		while (true)
+		{
+			u64 generation;
+
+			{
+				const std::unique_lock lock{m_mutex};
+				generation = m_generation;
+			}
+
+			bool wrote = false;
+			bool allClosed = true;
+
+			const auto busyStart = util::Instant::now();
+
+			for (auto &channel : m_channels)
+			{
+				// check before draining, so that nothing submitted before the close can be missed
+				const bool closed = channel->m_closed.load(std::memory_order::acquire);
+
+				while (channel->drainOne())
+				{
+					wrote = true;
+				}
+
+				allClosed &= closed;
+			}
+
+			if (allClosed)
+				break;
+
+			if (lastCheckpoint.elapsed() >= CheckpointInterval)
+			{
+				for (auto &channel : m_channels)
+				{
+					if (!channel->m_failed && !channel->m_file->sync())
+						channel->fail();
+
+					channel->updateDurable();
+				}
+
+				checkpoint();
+
+				lastCheckpoint = util::Instant::now();
+			}
+
+			m_busyTime.store(m_busyTime.load(std::memory_order::relaxed) + busyStart.elapsed(),
+				std::memory_order::relaxed);
+
+			if (!wrote)
+			{
+				std::unique_lock lock{m_mutex};
+				m_signal.wait_for(lock, std::chrono::duration<f64>(CheckpointInterval), [&]
+				{
+					return m_generation != generation;
+				});
+			}
+		}
+	}
+}
@@ -0,0 +1,199 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <span>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <ostream>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include <condition_variable>
+
+#include "manifest.h"
+#include "../util/memstream.h"
+#include "../util/timer.h"
+
+namespace oranj::datagen
+{
+	class OutputFile;
+	class AsyncWriter;
+
+	// One worker's output. Games are serialised into the current block, which
+	// is handed off to the writer thread through a single-producer single-consumer
+	// ring once it is large enough. Drained blocks are swapped back to the worker,
+	// so their allocations are reused rather than freed
+	class WriterChannel
+	{
+	public:
+		WriterChannel(AsyncWriter &writer, std::unique_ptr<OutputFile> file, const Checkpoint &initial);
+		~WriterChannel();
+
+		[[nodiscard]] inline auto stream() -> std::ostream &
+		{
+			return m_stream;
+		}
+
+		// marks everything serialised so far as a point the run can be resumed
+		// from. the offset is filled in here, the rest is up to the caller
+		auto checkpoint(Checkpoint checkpoint) -> void;
+
+		// call after each complete game, hands off the current block if it is full or old
+		auto commit() -> void;
+		// hands off any remaining data, nothing may be written after this
+		auto close() -> void;
+
+		// bytes serialised by the worker so far
+		[[nodiscard]] inline auto bytesWritten() const
+		{
+			return m_bytesSubmitted + m_current.data.size();
+		}
+
+		// number of times the worker had to wait for the writer thread
+		[[nodiscard]] inline auto stalls() const
+		{
+			return m_stalls;
+		}
+
+	private:
+		friend class AsyncWriter;
+
+		static constexpr usize BlockSize = 1024 * 1024;
+		// so that slow runs still checkpoint regularly
+		static constexpr f64 MaxBlockAge = 10.0;
+
+		static constexpr usize Capacity = 8;
+
+		static_assert((Capacity & (Capacity - 1)) == 0);
+
+		struct Block
+		{
+			std::vector<u8> data{};
+			// the last checkpoint within this block, if any
+			std::optional<Checkpoint> checkpoint{};
+		};
+
+		AsyncWriter &m_writer;
+
+		std::unique_ptr<OutputFile> m_file;
+
+		std::array<Block, Capacity> m_slots{};
+
+		alignas(64) std::atomic<usize> m_head{0};
+		alignas(64) std::atomic<usize> m_tail{0};
+		std::atomic_bool m_closed{false};
+
+		alignas(64) Block m_current{};
+		util::VectorOstream m_stream{m_current.data};
+
+		u64 m_baseOffset;
+
+		usize m_bytesSubmitted{};
+		usize m_stalls{};
+
+		util::Instant m_blockStart{util::Instant::now()};
+
+		// writer thread only
+		std::deque<Checkpoint> m_unflushed{};
+		Checkpoint m_durable;
+		// set once a write or sync fails, m_durable never advances after that
+		bool m_failed{false};
+
+		auto submit() -> void;
+
+		// writer thread side, true if a block was drained
+		auto drainOne() -> bool;
+		// advances m_durable past everything the file has flushed
+		auto updateDurable() -> void;
+		auto fail() -> void;
+	};
+
+	class AsyncWriter
+	{
+	public:
+		// called on the writer thread with each thread's latest checkpoint
+		// once the output up to them has been synced to disk
+		using CheckpointCallback = std::function<void(std::span<const Checkpoint>)>;
+
+		// called once, on the writer thread, the first time any output fails
+		using FailureCallback = std::function<void()>;
+
+		// directIo is best-effort, and only supported on linux
+		AsyncWriter(bool directIo, CheckpointCallback onCheckpoint, FailureCallback onFailure);
+		~AsyncWriter();
+
+		// must not be called after start(). if truncate is set, the file is truncated
+		// to initial.offset, otherwise the offset is set to the file's current size
+		auto open(const std::filesystem::path &path, Checkpoint initial, bool truncate) -> WriterChannel *;
+		// a channel whose output is thrown away, for dry runs
+		auto openDiscarding(Checkpoint initial) -> WriterChannel *;
+
+		// checkpoints the initial state, then starts the writer thread
+		auto start() -> void;
+		// waits for every channel to be closed and drained, then checkpoints a final time.
+		// false if any output failed, in which case checkpoints stop at the last durable one
+		auto finish() -> bool;
+
+		// seconds the writer thread has spent writing and syncing so far
+		[[nodiscard]] inline auto busyTime() const
+		{
+			return m_busyTime.load(std::memory_order::relaxed);
+		}
+
+	private:
+		friend class WriterChannel;
+
+		static constexpr f64 CheckpointInterval = 30.0;
+
+		bool m_directIo;
+		CheckpointCallback m_onCheckpoint;
+		FailureCallback m_onFailure;
+
+		bool m_failed{false};
+
+		std::vector<std::unique_ptr<WriterChannel>> m_channels{};
+
+		// bumped on every submission or close, so the writer thread can sleep when idle
+		std::mutex m_mutex{};
+		std::condition_variable m_signal{};
+		u64 m_generation{};
+
+		std::thread m_thread{};
+
+		std::atomic<f64> m_busyTime{};
+
+		util::Instant m_startTime{util::Instant::now()};
+
+		auto notify() -> void;
+		// writer thread only
+		auto fail() -> void;
+
+		auto checkpoint() -> void;
+
+		auto run() -> void;
+	};
+}
@@ -230,36 +230,56 @@ namespace oranj::eval
 		}
 	}
 
-	auto loadNetwork(const std::string &name) -> void
+	namespace
 	{
-		std::ifstream stream{name, std::ios::binary};
-
-		if (!stream)
+		auto loadNetworkFile(Network &network, const std::string &name) -> bool
 		{
-			std::cerr << "failed to open network file \"" << name << "\"" << std::endl;
-			return;
-		}
+			std::ifstream stream{name, std::ios::binary};
 
-		NetworkHeader header{};
-		stream.read(reinterpret_cast<char *>(&header), sizeof(NetworkHeader));
+			if (!stream)
+			{
+				std::cerr << "failed to open network file \"" << name << "\"" << std::endl;
+				return false;
+			}
 
-		if (!stream)
-		{
-			std::cerr << "failed to read network file header" << std::endl;
-			return;
-		}
+			NetworkHeader header{};
+			stream.read(reinterpret_cast<char *>(&header), sizeof(NetworkHeader));
 
-		if (!validate(header))
-			return;
+			if (!stream)
+			{
+				std::cerr << "failed to read network file header" << std::endl;
+				return false;
+			}
 
-		if (!loadNetworkFrom(s_network, stream, header))
-		{
-			std::cerr << "failed to read network parameters" << std::endl;
-			return;
+			if (!validate(header))
+				return false;
+
+			if (!loadNetworkFrom(network, stream, header))
+			{
+				std::cerr << "failed to read network parameters" << std::endl;
+				return false;
+			}
+
+			const std::string_view netName{header.name.data(), header.nameLen};
+			std::cout << "info string loaded network " << netName << std::endl;
+
+			return true;
 		}
+	}
+
+	auto loadNetwork(const std::string &name) -> void
+	{
+		loadNetworkFile(s_network, name);
+	}
+
+	auto readNetwork(const std::string &name) -> std::unique_ptr<Network>
+	{
+		auto network = std::make_unique<Network>();
+
+		if (!loadNetworkFile(*network, name))
+			return nullptr;
 
-		const std::string_view netName{header.name.data(), header.nameLen};
-		std::cout << "info string loaded network " << netName << std::endl;
+		return network;
 	}
 
 	auto defaultNetworkName() -> std::string_view
@@ -20,6 +20,8 @@
 
 #include "../types.h"
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "arch.h"
@@ -57,6 +59,9 @@ namespace oranj::eval
 	auto loadDefaultNetwork() -> void;
 	auto loadNetwork(const std::string &name) -> void;
 
+	// loads a network separately from the global one, for NnueState::setNetwork
+	[[nodiscard]] auto readNetwork(const std::string &name) -> std::unique_ptr<Network>;
+
 	[[nodiscard]] auto defaultNetworkName() -> std::string_view;
 
 	struct NnueUpdates
@@ -136,11 +141,17 @@ namespace oranj::eval
 			m_accumulatorStack.resize(256);
 		}
 
+		// the network must outlive this state, and applies from the next reset
+		inline auto setNetwork(const Network &network)
+		{
+			m_network = &network;
+		}
+
 		inline auto reset(const BitboardSet &bbs, KingPair kings)
 		{
 			assert(kings.isValid());
 
-			m_refreshTable.init(g_network.featureTransformer());
+			m_refreshTable.init(m_network->featureTransformer());
 
 			m_curr = &m_accumulatorStack[0];
 
@@ -150,7 +161,7 @@ namespace oranj::eval
 				const auto entry = InputFeatureSet::getRefreshTableEntry(c, king);
 
 				auto &rtEntry = m_refreshTable.table[entry];
-				resetAccumulator(rtEntry.accumulator, c, bbs, king);
+				resetAccumulator(*m_network, rtEntry.accumulator, c, bbs, king);
 
 				m_curr->acc.copyFrom(c, rtEntry.accumulator);
 				rtEntry.colorBbs(c) = bbs;
@@ -163,7 +174,7 @@ namespace oranj::eval
 			if constexpr (ApplyImmediately)
 			{
 				const UpdateContext ctx{updates, bbs, kings};
-				updateBoth(m_curr->acc, *m_curr, m_refreshTable, ctx);
+				updateBoth(*m_network, m_curr->acc, *m_curr, m_refreshTable, ctx);
 			}
 			else
 			{
@@ -187,7 +198,7 @@ namespace oranj::eval
 
 			ensureUpToDate(bbs, kings);
 
-			return evaluate(m_curr->acc, bbs, stm);
+			return evaluate(*m_network, m_curr->acc, bbs, stm);
 		}
 
 		[[nodiscard]] static inline auto evaluateOnce(const BitboardSet &bbs, KingPair kings, Color stm)
@@ -199,10 +210,10 @@ namespace oranj::eval
 
 			accumulator.initBoth(g_network.featureTransformer());
 
-			resetAccumulator(accumulator, Color::Black, bbs, kings.black());
-			resetAccumulator(accumulator, Color::White, bbs, kings.white());
+			resetAccumulator(g_network, accumulator, Color::Black, bbs, kings.black());
+			resetAccumulator(g_network, accumulator, Color::White, bbs, kings.white());
 
-			return evaluate(accumulator, bbs, stm);
+			return evaluate(g_network, accumulator, bbs, stm);
 		}
 
 	private:
@@ -211,12 +222,14 @@ namespace oranj::eval
 
 		RefreshTable m_refreshTable{};
 
-		static inline auto update(const Accumulator &prev, UpdatableAccumulator &curr,
+		const Network *m_network{&g_network};
+
+		static inline auto update(const Network &network, const Accumulator &prev, UpdatableAccumulator &curr,
 			RefreshTable &refreshTable, const UpdateContext &ctx, Color c) -> void
 		{
 			if (ctx.updates.requiresRefresh(c))
 			{
-				refreshAccumulator(curr, c, ctx.bbs, refreshTable, ctx.kings.color(c));
+				refreshAccumulator(network, curr, c, ctx.bbs, refreshTable, ctx.kings.color(c));
 				return;
 			}
 
@@ -236,7 +249,7 @@ namespace oranj::eval
 				const auto sub = featureIndex(c, subPiece, subSquare, king);
 				const auto add = featureIndex(c, addPiece, addSquare, king);
 
-				curr.acc.subAddFrom(prev, g_network.featureTransformer(), c, sub, add);
+				curr.acc.subAddFrom(prev, network.featureTransformer(), c, sub, add);
 			}
 			else if (addCount == 1 && subCount == 2) // any capture
 			{
@@ -248,18 +261,18 @@ namespace oranj::eval
 				const auto sub1 = featureIndex(c, subPiece1, subSquare1, king);
 				const auto add  = featureIndex(c, addPiece , addSquare , king);
 
-				curr.acc.subSubAddFrom(prev, g_network.featureTransformer(), c, sub0, sub1, add);
+				curr.acc.subSubAddFrom(prev, network.featureTransformer(), c, sub0, sub1, add);
 			}
 			else assert(false && "Materialising a piece from nowhere?");
 
 			curr.setUpdated(c);
 		}
 
-		static inline auto updateBoth(const Accumulator &prev, UpdatableAccumulator &curr,
+		static inline auto updateBoth(const Network &network, const Accumulator &prev, UpdatableAccumulator &curr,
 			RefreshTable &refreshTable, const UpdateContext &ctx) -> void
 		{
-			update(prev, curr, refreshTable, ctx, Color::Black);
-			update(prev, curr, refreshTable, ctx, Color::White);
+			update(network, prev, curr, refreshTable, ctx, Color::Black);
+			update(network, prev, curr, refreshTable, ctx, Color::White);
 		}
 
 		inline auto ensureUpToDate(const BitboardSet &bbs, KingPair kings) -> void
@@ -272,7 +285,7 @@ namespace oranj::eval
 				// if the current accumulator needs a refresh, just do it
 				if (m_curr->ctx.updates.requiresRefresh(c))
 				{
-					refreshAccumulator(*m_curr, c, bbs, m_refreshTable, kings.color(c));
+					refreshAccumulator(*m_network, *m_curr, c, bbs, m_refreshTable, kings.color(c));
 					continue;
 				}
 
@@ -287,7 +300,7 @@ namespace oranj::eval
 
 				// if the found accumulator requires a refresh, just give up and refresh the current one
 				if (curr->ctx.updates.requiresRefresh(c))
-					refreshAccumulator(*m_curr, c, bbs, m_refreshTable, kings.color(c));
+					refreshAccumulator(*m_network, *m_curr, c, bbs, m_refreshTable, kings.color(c));
 				else // otherwise go forward and incrementally update all accumulators in between
 				{
 					do
@@ -295,24 +308,24 @@ namespace oranj::eval
 						const auto &prev = *curr;
 
 						++curr;
-						update(prev.acc, *curr, m_refreshTable, curr->ctx, c);
+						update(*m_network, prev.acc, *curr, m_refreshTable, curr->ctx, c);
 					}
 					while (curr != m_curr);
 				}
 			}
 		}
 
-		[[nodiscard]] static inline auto evaluate(const Accumulator &accumulator,
+		[[nodiscard]] static inline auto evaluate(const Network &network, const Accumulator &accumulator,
 			const BitboardSet &bbs, Color stm) -> i32
 		{
 			assert(stm != Color::None);
 
 			return stm == Color::Black
-				? g_network.propagate(bbs, accumulator.black(), accumulator.white())
-				: g_network.propagate(bbs, accumulator.white(), accumulator.black());
+				? network.propagate(bbs, accumulator.black(), accumulator.white())
+				: network.propagate(bbs, accumulator.white(), accumulator.black());
 		}
 
-		static inline auto refreshAccumulator(UpdatableAccumulator &accumulator, Color c,
+		static inline auto refreshAccumulator(const Network &network, UpdatableAccumulator &accumulator, Color c,
 			const BitboardSet &bbs, RefreshTable &refreshTable, Square king) -> void
 		{
 			const auto tableIdx = InputFeatureSet::getRefreshTableEntry(c, king);
@@ -335,7 +348,7 @@ namespace oranj::eval
 					const auto sq = added.popLowestSquare();
 					const auto feature = featureIndex(c, piece, sq, king);
 
-					rtEntry.accumulator.activateFeature(g_network.featureTransformer(), c, feature);
+					rtEntry.accumulator.activateFeature(network.featureTransformer(), c, feature);
 				}
 
 				while (removed)
@@ -343,7 +356,7 @@ namespace oranj::eval
 					const auto sq = removed.popLowestSquare();
 					const auto feature = featureIndex(c, piece, sq, king);
 
-					rtEntry.accumulator.deactivateFeature(g_network.featureTransformer(), c, feature);
+					rtEntry.accumulator.deactivateFeature(network.featureTransformer(), c, feature);
 				}
 			}
 
@@ -353,7 +366,7 @@ namespace oranj::eval
 			accumulator.setUpdated(c);
 		}
 
-		static inline auto resetAccumulator(Accumulator &accumulator,
+		static inline auto resetAccumulator(const Network &network, Accumulator &accumulator,
 			Color c, const BitboardSet &bbs, Square king) -> void
 		{
 			assert(c != Color::None);
@@ -371,15 +384,15 @@ namespace oranj::eval
 					const auto sq = board.popLowestSquare();
 
 					const auto feature = featureIndex(c, piece, sq, king);
-					accumulator.activateFeature(g_network.featureTransformer(), c, feature);
+					accumulator.activateFeature(network.featureTransformer(), c, feature);
 				}
 			}
 		}
 
-		static inline auto resetAccumulator(UpdatableAccumulator &accumulator,
+		static inline auto resetAccumulator(const Network &network, UpdatableAccumulator &accumulator,
 			Color c, const BitboardSet &bbs, Square king) -> void
 		{
-			resetAccumulator(accumulator.acc, c, bbs, king);
+			resetAccumulator(network, accumulator.acc, c, bbs, king);
 			accumulator.setUpdated(c);
 		}
 
@@ -111,6 +111,15 @@ namespace oranj
 			std::memset(&m_noisy       , 0, sizeof(m_noisy       ));
 		}
 
+		// scales every entry by scale / 1024, so the next search keeps
+		// what was learnt on previous moves without being dominated by it
+		inline auto age(i32 scale)
+		{
+			ageTable(m_main        , scale);
+			ageTable(m_continuation, scale);
+			ageTable(m_noisy       , scale);
+		}
+
 		[[nodiscard]] inline auto contTable(Piece moving, Square to) const -> const auto &
 		{
 			return m_continuation[static_cast<i32>(moving)][static_cast<i32>(to)];
@@ -170,6 +179,20 @@ namespace oranj
 		// additional slot for non-capture promos
 		util::MultiArray<HistoryEntry, 64, 64, 13, 2> m_noisy{};
 
+		template <typename T>
+		static inline auto ageTable(T &table, i32 scale) -> void
+		{
+			static_assert(sizeof(T) % sizeof(HistoryEntry) == 0);
+
+			// every table is a dense multidimensional array of entries
+			auto *entries = reinterpret_cast<HistoryEntry *>(&table);
+
+			for (usize i = 0; i < sizeof(T) / sizeof(HistoryEntry); ++i)
+			{
+				entries[i].value = static_cast<HistoryScore>(entries[i].value * scale / 1024);
+			}
+		}
+
 		static inline auto updateConthist(std::span<ContinuationSubtable *> continuations,
 			i32 ply, Piece moving, Move move, HistoryScore bonus, i32 offset) -> void
 		{
@@ -55,6 +55,14 @@ namespace oranj::limit
 			}
 		}
 
+		inline auto ponderhit() -> void final
+		{
+			for (const auto &limiter : m_limiters)
+			{
+				limiter->ponderhit();
+			}
+		}
+
 		[[nodiscard]] inline auto stop(const search::SearchData &data, bool allowSoftTimeout) -> bool final
 		{
 			return std::ranges::any_of(m_limiters, [&](const auto &limiter)
@@ -32,6 +32,10 @@ namespace oranj::limit
 		virtual auto update(const search::SearchData &data, Score score, Move bestMove, usize totalNodes) -> void {}
 		virtual auto updateMoveNodes(Move move, usize nodes) -> void {}
 
+		// called from the uci thread when a ponder search becomes a real one
+		// stop() is not called between go ponder and ponderhit
+		virtual auto ponderhit() -> void {}
+
 		[[nodiscard]] virtual auto stop(const search::SearchData &data, bool allowSoftTimeout) -> bool = 0;
 
 		[[nodiscard]] virtual auto stopped() const -> bool = 0;
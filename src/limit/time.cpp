@@ -29,7 +29,13 @@ namespace oranj::limit
 	using util::Instant;
 
 	MoveTimeLimiter::MoveTimeLimiter(i64 time, i64 overhead)
-		: m_endTime{Instant::now() + static_cast<f64>(std::max<i64>(1, time - overhead)) / 1000.0} {}
+		: m_time{static_cast<f64>(std::max<i64>(1, time - overhead)) / 1000.0},
+		  m_endTime{Instant::now() + m_time} {}
+
+	auto MoveTimeLimiter::ponderhit() -> void
+	{
+		m_endTime = Instant::now() + m_time;
+	}
 
 	auto MoveTimeLimiter::stop(const search::SearchData &data, bool allowSoftTimeout) -> bool
 	{
@@ -118,6 +124,14 @@ namespace oranj::limit
 		m_moveNodeCounts[move.srcIdx()][move.dstIdx()] += nodes;
 	}
 
+	auto TimeManager::ponderhit() -> void
+	{
+		// our clock only started running on ponderhit, so the hard limit
+		// restarts from here, but the soft limit keeps the time already
+		// spent pondering as a head start on the next iterations
+		m_ponderTime = m_startTime.elapsed();
+	}
+
 	auto TimeManager::stop(const search::SearchData &data, bool allowSoftTimeout) -> bool
 	{
 		if (data.nodes == 0
@@ -126,7 +140,7 @@ namespace oranj::limit
 
 		const auto elapsed = m_startTime.elapsed();
 
-		if (elapsed > m_maxTime || (allowSoftTimeout && elapsed > m_softTime * m_scale))
+		if (elapsed - m_ponderTime > m_maxTime || (allowSoftTimeout && elapsed > m_softTime * m_scale))
 		{
 			m_stopped.store(true, std::memory_order_release);
 			return true;
@@ -40,11 +40,14 @@ namespace oranj::limit
 		explicit MoveTimeLimiter(i64 time, i64 overhead = 0);
 		~MoveTimeLimiter() final = default;
 
+		auto ponderhit() -> void final;
+
 		[[nodiscard]] auto stop(const search::SearchData &data, bool allowSoftTimeout) -> bool final;
 
 		[[nodiscard]] auto stopped() const -> bool final;
 
 	private:
+		f64 m_time;
 		util::Instant m_endTime;
 		std::atomic_bool m_stopped{false};
 	};
@@ -58,13 +61,29 @@ namespace oranj::limit
 		auto update(const search::SearchData &data, Score score, Move bestMove, usize totalNodes) -> void final;
 		auto updateMoveNodes(Move move, usize nodes) -> void final;
 
+		auto ponderhit() -> void final;
+
 		[[nodiscard]] auto stop(const search::SearchData &data, bool allowSoftTimeout) -> bool final;
 
 		[[nodiscard]] auto stopped() const -> bool final;
 
+		// base allocations, before any scaling from update()
+		[[nodiscard]] inline auto softTime() const
+		{
+			return m_softTime;
+		}
+
+		[[nodiscard]] inline auto maxTime() const
+		{
+			return m_maxTime;
+		}
+
 	private:
 		util::Instant m_startTime;
 
+		// time spent pondering before ponderhit, only excluded from the hard limit
+		f64 m_ponderTime{};
+
 		f64 m_softTime{};
 		f64 m_maxTime{};
 
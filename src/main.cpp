@@ -16,9 +16,22 @@
  * along with oranj. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <filesystem>
+#include <span>
+#include <thread>
+#include <limits>
+#include <optional>
+
 #include "uci.h"
 #include "bench.h"
+#include "replay.h"
+#include "perft.h"
 #include "datagen/datagen.h"
+#include "datagen/chainformat.h"
+#include "datagen/selfplay.h"
+#include "datagen/tools.h"
+#include "datagen/marlinformat.h"
+#include "datagen/viriformat.h"
 #include "util/parse.h"
 #include "eval/nnue.h"
 #include "tunable.h"
@@ -31,6 +44,85 @@
 
 using namespace oranj;
 
+namespace
+{
+	enum class OptionResult
+	{
+		NotAnOption,
+		Parsed,
+		// already reported
+		Invalid,
+	};
+
+	// options shared by datagen and selfplay. value() consumes and returns the
+	// next argument, if any. anything starting with -- is treated as a knob
+	auto parseCommonDatagenOption(const std::string &arg, auto &&value, datagen::Config &config) -> OptionResult
+	{
+		if (arg == "--config")
+		{
+			const auto path = value();
+
+			if (!path || !datagen::loadKnobs(*path, config.knobs))
+				return OptionResult::Invalid;
+		}
+		else if (arg == "--tt")
+		{
+			const auto size = value();
+
+			if (!size || !util::tryParseSize(config.ttSizeMib, *size))
+			{
+				std::cerr << "invalid tt size" << std::endl;
+				return OptionResult::Invalid;
+			}
+
+			config.ttSizeMib = TtSizeMibRange.clamp(config.ttSizeMib);
+		}
+		else if (arg == "--seed")
+		{
+			const auto seed = value();
+
+			if (!seed || !(config.seed = util::tryParseU64(*seed)))
+			{
+				std::cerr << "invalid seed" << std::endl;
+				return OptionResult::Invalid;
+			}
+		}
+		else if (arg == "--openings")
+		{
+			const auto path = value();
+
+			if (!path)
+			{
+				std::cerr << "missing opening book path" << std::endl;
+				return OptionResult::Invalid;
+			}
+
+			config.openings = std::filesystem::absolute(*path).string();
+		}
+		else if (arg == "--random-plies")
+		{
+			const auto plies = value();
+
+			if (!plies || !util::tryParseU32(config.randomPlies, *plies))
+			{
+				std::cerr << "invalid number of random plies" << std::endl;
+				return OptionResult::Invalid;
+			}
+		}
+		else if (arg.starts_with("--"))
+		{
+			if (const auto knob = value(); !knob || !datagen::setKnob(config.knobs, arg.substr(2), *knob))
+			{
+				std::cerr << "unknown option or invalid value " << arg << std::endl;
+				return OptionResult::Invalid;
+			}
+		}
+		else return OptionResult::NotAnOption;
+
+		return OptionResult::Parsed;
+	}
+}
+
 auto main(i32 argc, const char *argv[]) -> i32
 {
 	util::signal::init();
@@ -51,49 +143,448 @@ auto main(i32 argc, const char *argv[]) -> i32
 
 			return 0;
 		}
+		else if (mode == "perftsuite")
+		{
+			const auto printUsage = [&]()
+			{
+				std::cerr << "usage: " << argv[0] << " perftsuite [epd file] [--threads <n>] [--depth <max depth>]" << std::endl;
+			};
+
+			std::optional<std::string> epdFile{};
+
+			u32 threads = std::max(std::thread::hardware_concurrency(), 1U);
+			i32 maxDepth = std::numeric_limits<i32>::max();
+
+			for (i32 i = 2; i < argc; ++i)
+			{
+				const std::string arg{argv[i]};
+
+				if (arg == "--threads")
+				{
+					if (i + 1 >= argc || !util::tryParseU32(threads, argv[++i]) || threads == 0)
+					{
+						std::cerr << "invalid number of threads" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (arg == "--depth")
+				{
+					if (i + 1 >= argc || !util::tryParseI32(maxDepth, argv[++i]) || maxDepth < 1)
+					{
+						std::cerr << "invalid depth" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (!epdFile)
+					epdFile = arg;
+				else
+				{
+					printUsage();
+					return 1;
+				}
+			}
+
+			return perftSuite(epdFile, threads, maxDepth) ? 0 : 1;
+		}
+		else if (mode == "rookbench")
+		{
+			bench::runRookBench();
+			return 0;
+		}
+		else if (mode == "fenbench")
+		{
+			if (argc > 3)
+			{
+				std::cerr << "usage: " << argv[0] << " fenbench [fen file]" << std::endl;
+				return 1;
+			}
+
+			const auto path = argc > 2 ? std::optional<std::string>{argv[2]} : std::nullopt;
+			return bench::runFenBench(path) ? 0 : 1;
+		}
+		else if (mode == "replaybench")
+		{
+			if (argc < 4)
+			{
+				std::cerr << "usage: " << argv[0] << " replaybench <game file> <base+increment> [tt size]" << std::endl;
+				return 1;
+			}
+
+			usize ttSize = DefaultTtSizeMib;
+			if (argc > 4 && !util::tryParseSize(ttSize, argv[4]))
+			{
+				std::cerr << "invalid tt size " << argv[4] << std::endl;
+				return 1;
+			}
+
+			return replay::run(argv[2], argv[3], TtSizeMibRange.clamp(ttSize));
+		}
 		else if (mode == "datagen")
 		{
 			const auto printUsage = [&]()
 			{
 				std::cerr << "usage: " << argv[0]
-					<< " datagen <marlinformat/viriformat/fen> <standard/dfrc> <path> [threads] [game limit per thread]"
+					<< " datagen <marlinformat/viriformat/chainformat/fen> <standard/dfrc> <path> [threads] [game limit per thread]"
+					<< " [--direct-io] [--tt <MiB per thread>] [--seed <seed>] [--openings <epd file>] [--random-plies <n>]"
+					<< " [--config <knob file>] [--<knob> <value>]" << std::endl;
+				std::cerr << "       " << argv[0] << " datagen --resume <path> [--direct-io]" << std::endl;
+				std::cerr << "       " << argv[0]
+					<< " datagen --dry-run <format> <standard/dfrc> [threads] [game limit per thread] [options]" << std::endl;
+			};
+
+			std::vector<std::string> args{};
+
+			datagen::Config config{};
+			bool resume = false;
+
+			for (i32 i = 2; i < argc; ++i)
+			{
+				const std::string arg{argv[i]};
+
+				const auto value = [&]() -> std::optional<std::string>
+				{
+					if (i + 1 >= argc)
+						return {};
+					return argv[++i];
+				};
+
+				if (arg == "--direct-io")
+					config.directIo = true;
+				else if (arg == "--resume")
+					resume = true;
+				else if (arg == "--dry-run")
+					config.dryRun = true;
+				else if (const auto result = parseCommonDatagenOption(arg, value, config);
+					result == OptionResult::Invalid)
+				{
+					printUsage();
+					return 1;
+				}
+				else if (result == OptionResult::NotAnOption)
+					args.push_back(arg);
+			}
+
+			if (resume)
+			{
+				if (args.size() != 1)
+				{
+					printUsage();
+					return 1;
+				}
+
+				return datagen::resume(args[0], config.directIo);
+			}
+
+			// dry runs have no output path
+			if (config.dryRun)
+				args.insert(args.begin() + std::min<usize>(args.size(), 2), std::string{});
+
+			if (args.size() < 3)
+			{
+				printUsage();
+				return 1;
+			}
+
+			config.format = args[0];
+
+			if (args[1] == "dfrc")
+				config.dfrc = true;
+			else if (args[1] != "standard")
+			{
+				std::cerr << "invalid variant " << args[1] << std::endl;
+				printUsage();
+				return 1;
+			}
+
+			config.output = args[2];
+
+			if (args.size() > 3 && (!util::tryParseU32(config.threads, args[3]) || config.threads == 0))
+			{
+				std::cerr << "invalid number of threads " << args[3] << std::endl;
+				printUsage();
+				return 1;
+			}
+
+			if (args.size() > 4 && !util::tryParseU32(config.games, args[4]))
+			{
+				std::cerr << "invalid number of games " << args[4] << std::endl;
+				printUsage();
+				return 1;
+			}
+			else if (args.size() <= 4 && config.dryRun)
+				config.games = datagen::DefaultDryRunGames;
+
+			return datagen::run(printUsage, config);
+		}
+		else if (mode == "selfplay")
+		{
+			const auto printUsage = [&]()
+			{
+				std::cerr << "usage: " << argv[0] << " selfplay <games> [threads] [--dfrc] [--tt <MiB per side>]"
+					<< " [--seed <seed>] [--openings <epd file>] [--random-plies <n>] [--config <knob file>] [--<knob> <value>]"
+					<< " [--net-a/--net-b <network file>] [--nodes-a/--nodes-b <soft nodes>] [--depth-a/--depth-b <depth>]"
 					<< std::endl;
 			};
 
-			if (argc < 5)
+			std::vector<std::string> args{};
+
+			datagen::selfplay::MatchConfig config{};
+
+			for (i32 i = 2; i < argc; ++i)
+			{
+				const std::string arg{argv[i]};
+
+				const auto value = [&]() -> std::optional<std::string>
+				{
+					if (i + 1 >= argc)
+						return {};
+					return argv[++i];
+				};
+
+				// --net-a, --nodes-b etc.
+				const auto sideIdx = arg.ends_with("-a") ? 0 : 1;
+				auto &side = config.sides[sideIdx];
+
+				if (arg == "--dfrc")
+					config.base.dfrc = true;
+				else if (arg == "--net-a" || arg == "--net-b")
+				{
+					const auto path = value();
+
+					if (!path)
+					{
+						printUsage();
+						return 1;
+					}
+
+					side.network = *path;
+				}
+				else if (arg == "--nodes-a" || arg == "--nodes-b")
+				{
+					const auto nodes = value();
+
+					if (!nodes || !(side.nodes = util::tryParseSize(*nodes)))
+					{
+						std::cerr << "invalid node limit" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (arg == "--depth-a" || arg == "--depth-b")
+				{
+					const auto depth = value();
+
+					if (!depth || !(side.depth = util::tryParseI32(*depth)) || *side.depth < 1 || *side.depth > MaxDepth)
+					{
+						std::cerr << "invalid depth" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (const auto result = parseCommonDatagenOption(arg, value, config.base);
+					result == OptionResult::Invalid)
+				{
+					printUsage();
+					return 1;
+				}
+				else if (result == OptionResult::NotAnOption)
+					args.push_back(arg);
+			}
+
+			if (args.empty() || args.size() > 2)
 			{
 				printUsage();
 				return 1;
 			}
 
-			bool dfrc = false;
+			if (!util::tryParseU32(config.base.games, args[0]) || config.base.games == 0)
+			{
+				std::cerr << "invalid number of games " << args[0] << std::endl;
+				printUsage();
+				return 1;
+			}
 
-			if (std::string{argv[3]} == "dfrc")
-				dfrc = true;
-			else if (std::string{argv[3]} != "standard")
+			if (args.size() > 1 && (!util::tryParseU32(config.base.threads, args[1]) || config.base.threads == 0))
 			{
-				std::cerr << "invalid variant " << argv[3] << std::endl;
+				std::cerr << "invalid number of threads " << args[1] << std::endl;
 				printUsage();
 				return 1;
 			}
 
-			u32 threads = 1;
-			if (argc > 5 && !util::tryParseU32(threads, argv[5]))
+			return datagen::selfplay::run(config);
+		}
+		else if (mode == "verifychainformat")
+		{
+			if (argc < 3)
+			{
+				std::cerr << "usage: " << argv[0] << " verifychainformat <viriformat file>" << std::endl;
+				return 1;
+			}
+
+			return datagen::chainformat::verify(argv[2]);
+		}
+		else if (mode == "shuffle"
+			|| mode == "dedupe"
+			|| mode == "interleave"
+			|| mode == "split")
+		{
+			const auto printUsage = [&]()
+			{
+				std::cerr << "usage: " << argv[0] << " shuffle <marlinformat/viriformat> <input> <output> [options]" << std::endl;
+				std::cerr << "       " << argv[0] << " dedupe <marlinformat/viriformat> <input> <output> [options]" << std::endl;
+				std::cerr << "       " << argv[0] << " interleave <marlinformat/viriformat> <output> <inputs...> [options]" << std::endl;
+				std::cerr << "       " << argv[0]
+					<< " split <marlinformat/viriformat> <input> <train output> <validation output> <validation fraction>" << std::endl;
+				std::cerr << "options: [--threads <n>] [--memory <MiB>] [--seed <seed>]" << std::endl;
+			};
+
+			std::vector<std::string> args{};
+
+			datagen::tools::ToolOptions options{
+				.threads = std::max(std::thread::hardware_concurrency(), 1U),
+			};
+
+			for (i32 i = 2; i < argc; ++i)
+			{
+				const std::string arg{argv[i]};
+
+				const auto value = [&]() -> std::optional<std::string>
+				{
+					if (i + 1 >= argc)
+						return {};
+					return argv[++i];
+				};
+
+				if (arg == "--threads")
+				{
+					const auto threads = value();
+
+					if (!threads || !util::tryParseU32(options.threads, *threads) || options.threads == 0)
+					{
+						std::cerr << "invalid number of threads" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (arg == "--memory")
+				{
+					const auto memory = value();
+
+					if (!memory || !util::tryParseSize(options.memoryMib, *memory) || options.memoryMib == 0)
+					{
+						std::cerr << "invalid memory limit" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (arg == "--seed")
+				{
+					const auto seed = value();
+
+					if (!seed || !(options.seed = util::tryParseU64(*seed)))
+					{
+						std::cerr << "invalid seed" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else if (arg.starts_with("--"))
+				{
+					std::cerr << "unknown option " << arg << std::endl;
+					printUsage();
+					return 1;
+				}
+				else args.push_back(arg);
+			}
+
+			if (mode == "split")
+			{
+				f64 fraction{};
+
+				if (args.size() != 5 || !util::tryParseF64(fraction, args[4]))
+				{
+					printUsage();
+					return 1;
+				}
+
+				return datagen::tools::split(args[0], args[1], args[2], args[3], fraction);
+			}
+			else if (mode == "interleave")
+			{
+				if (args.size() < 3)
+				{
+					printUsage();
+					return 1;
+				}
+
+				return datagen::tools::interleave(args[0], std::span{args}.subspan(2), args[1], options);
+			}
+
+			if (args.size() != 3)
 			{
-				std::cerr << "invalid number of threads " << argv[5] << std::endl;
 				printUsage();
 				return 1;
 			}
 
-			auto games = datagen::UnlimitedGames;
-			if (argc > 6 && !util::tryParseU32(games, argv[6]))
+			return mode == "shuffle"
+				? datagen::tools::shuffle(args[0], args[1], args[2], options)
+				: datagen::tools::dedupe(args[0], args[1], args[2], options);
+		}
+		else if (mode == "analyze")
+		{
+			const auto printUsage = [&]()
+			{
+				std::cerr << "usage: " << argv[0] << " analyze <file> [marlinformat/viriformat] [--threads <n>]" << std::endl;
+			};
+
+			std::vector<std::string> args{};
+
+			datagen::tools::ToolOptions options{
+				.threads = std::max(std::thread::hardware_concurrency(), 1U),
+			};
+
+			for (i32 i = 2; i < argc; ++i)
+			{
+				const std::string arg{argv[i]};
+
+				if (arg == "--threads")
+				{
+					if (i + 1 >= argc || !util::tryParseU32(options.threads, argv[++i]) || options.threads == 0)
+					{
+						std::cerr << "invalid number of threads" << std::endl;
+						printUsage();
+						return 1;
+					}
+				}
+				else args.push_back(arg);
+			}
+
+			if (args.empty() || args.size() > 2)
 			{
-				std::cerr << "invalid number of games " << argv[6] << std::endl;
 				printUsage();
 				return 1;
 			}
 
-			return datagen::run(printUsage, argv[2], dfrc, argv[4], static_cast<i32>(threads), games);
+			// guess the format from the extension datagen gives it
+			if (args.size() == 1)
+			{
+				const auto extension = std::filesystem::path{args[0]}.extension();
+
+				if (extension == std::string{"."} + datagen::Marlinformat::Extension)
+					args.emplace_back("marlinformat");
+				else if (extension == std::string{"."} + datagen::Viriformat::Extension)
+					args.emplace_back("viriformat");
+				else
+				{
+					std::cerr << "cannot determine the format of " << args[0] << ", please specify it" << std::endl;
+					printUsage();
+					return 1;
+				}
+			}
+
+			return datagen::tools::analyze(args[1], args[0], options);
 		}
 #if OJ_EXTERNAL_TUNE
 		else if (mode == "printwf"
@@ -62,7 +62,7 @@ namespace oranj
 		}
 
 		template <Color Us>
-		auto generatePawnsNoisy_(ScoredMoveList &noisy, const Position &pos, Bitboard dstMask)
+		auto generatePawnsNoisy_(ScoredMoveList &noisy, const Position &pos, Bitboard dstMask, Bitboard srcMask)
 		{
 			constexpr auto Them = oppColor(Us);
 
@@ -78,7 +78,7 @@ namespace oranj
 
 			const auto forwardDstMask = dstMask & PromotionRank & ~theirs;
 
-			const auto pawns = bbs.pawns<Us>();
+			const auto pawns = bbs.pawns<Us>() & srcMask;
 
 			const auto leftAttacks = pawns.template shiftUpLeftRelative<Us>() & dstMask;
 			const auto rightAttacks = pawns.template shiftUpRightRelative<Us>() & dstMask;
@@ -93,15 +93,17 @@ namespace oranj
 			pushStandards(noisy, RightOffset, rightAttacks & theirs & ~PromotionRank);
 		}
 
-		inline auto generatePawnsNoisy(ScoredMoveList &noisy, const Position &pos, Bitboard dstMask)
+		inline auto generatePawnsNoisy(ScoredMoveList &noisy, const Position &pos,
+			Bitboard dstMask, Bitboard srcMask = boards::All)
 		{
 			if (pos.toMove() == Color::Black)
-				generatePawnsNoisy_<Color::Black>(noisy, pos, dstMask);
-			else generatePawnsNoisy_<Color::White>(noisy, pos, dstMask);
+				generatePawnsNoisy_<Color::Black>(noisy, pos, dstMask, srcMask);
+			else generatePawnsNoisy_<Color::White>(noisy, pos, dstMask, srcMask);
 		}
 
 		template <Color Us>
-		auto generatePawnsQuiet_(ScoredMoveList &quiet, const BitboardSet &bbs, Bitboard dstMask, Bitboard occ)
+		auto generatePawnsQuiet_(ScoredMoveList &quiet, const BitboardSet &bbs,
+			Bitboard dstMask, Bitboard occ, Bitboard srcMask)
 		{
 			constexpr auto PromotionRank = boards::promotionRank<Us>();
 
@@ -109,25 +111,26 @@ namespace oranj
 
 			const auto forwardDstMask = dstMask & ~PromotionRank & ~occ;
 
-			const auto pawns = bbs.pawns<Us>();
+			const auto pawns = bbs.pawns<Us>() & srcMask;
 
 			const auto forwards = pawns.template shiftUpRelative<Us>() & forwardDstMask;
 			pushStandards(quiet, ForwardOffset, forwards);
 		}
 
-		inline auto generatePawnsQuiet(ScoredMoveList &quiet, const Position &pos, Bitboard dstMask, Bitboard occ)
+		inline auto generatePawnsQuiet(ScoredMoveList &quiet, const Position &pos,
+			Bitboard dstMask, Bitboard occ, Bitboard srcMask = boards::All)
 		{
 			if (pos.toMove() == Color::Black)
-				generatePawnsQuiet_<Color::Black>(quiet, pos.bbs(), dstMask, occ);
-			else generatePawnsQuiet_<Color::White>(quiet, pos.bbs(), dstMask, occ);
+				generatePawnsQuiet_<Color::Black>(quiet, pos.bbs(), dstMask, occ, srcMask);
+			else generatePawnsQuiet_<Color::White>(quiet, pos.bbs(), dstMask, occ, srcMask);
 		}
 
 		template <PieceType Piece, const std::array<Bitboard, 64> &Attacks>
-		inline auto precalculated(ScoredMoveList &dst, const Position &pos, Bitboard dstMask)
+		inline auto precalculated(ScoredMoveList &dst, const Position &pos, Bitboard dstMask, Bitboard srcMask)
 		{
 			const auto us = pos.toMove();
 
-			auto pieces = pos.bbs().forPiece(Piece, us);
+			auto pieces = pos.bbs().forPiece(Piece, us) & srcMask;
 			while (!pieces.empty())
 			{
 				const auto srcSquare = pieces.popLowestSquare();
@@ -137,27 +140,27 @@ namespace oranj
 			}
 		}
 
-		auto generateAlfils(ScoredMoveList &dst, const Position &pos, Bitboard dstMask)
+		auto generateAlfils(ScoredMoveList &dst, const Position &pos, Bitboard dstMask, Bitboard srcMask = boards::All)
 		{
-			precalculated<PieceType::Alfil, attacks::AlfilAttacks>(dst, pos, dstMask);
+			precalculated<PieceType::Alfil, attacks::AlfilAttacks>(dst, pos, dstMask, srcMask);
 		}
 
-		auto generateFerzes(ScoredMoveList &dst, const Position &pos, Bitboard dstMask)
+		auto generateFerzes(ScoredMoveList &dst, const Position &pos, Bitboard dstMask, Bitboard srcMask = boards::All)
 		{
-			precalculated<PieceType::Ferz, attacks::FerzAttacks>(dst, pos, dstMask);
+			precalculated<PieceType::Ferz, attacks::FerzAttacks>(dst, pos, dstMask, srcMask);
 		}
 
-		auto generateKnights(ScoredMoveList &dst, const Position &pos, Bitboard dstMask)
+		auto generateKnights(ScoredMoveList &dst, const Position &pos, Bitboard dstMask, Bitboard srcMask = boards::All)
 		{
-			precalculated<PieceType::Knight, attacks::KnightAttacks>(dst, pos, dstMask);
+			precalculated<PieceType::Knight, attacks::KnightAttacks>(dst, pos, dstMask, srcMask);
 		}
 
-		auto generateKings(ScoredMoveList &dst, const Position &pos, Bitboard dstMask)
+		auto generateKings(ScoredMoveList &dst, const Position &pos, Bitboard dstMask, Bitboard srcMask = boards::All)
 		{
-			precalculated<PieceType::King, attacks::KingAttacks>(dst, pos, dstMask);
+			precalculated<PieceType::King, attacks::KingAttacks>(dst, pos, dstMask, srcMask);
 		}
 
-		auto generateRooks(ScoredMoveList &dst, const Position &pos, Bitboard dstMask)
+		auto generateRooks(ScoredMoveList &dst, const Position &pos, Bitboard dstMask, Bitboard srcMask = boards::All)
 		{
 			const auto &bbs = pos.bbs();
 
@@ -169,7 +172,7 @@ namespace oranj
 
 			const auto occupancy = ours | theirs;
 
-			auto rooks = bbs.rooks(us);
+			auto rooks = bbs.rooks(us) & srcMask;
 
 			while (!rooks.empty())
 			{
@@ -179,6 +182,134 @@ namespace oranj
 				pushStandards(dst, src, attacks & dstMask);
 			}
 		}
+
+		// squares our king cannot step to - everything the opponent attacks, plus
+		// the squares behind the king on the line of a checking rook, which only
+		// look safe because the king itself blocks the ray
+		auto kingDanger(const Position &pos)
+		{
+			const auto &bbs = pos.bbs();
+
+			const auto us = pos.toMove();
+			const auto them = oppColor(us);
+
+			auto danger = pos.threats();
+
+			const auto kinglessOcc = bbs.occupancy() ^ bbs.kings(us);
+
+			auto rookCheckers = pos.checkers() & bbs.rooks(them);
+			while (!rookCheckers.empty())
+			{
+				const auto checker = rookCheckers.popLowestSquare();
+				danger |= attacks::getRookAttacks(checker, kinglessOcc);
+			}
+
+			return danger;
+		}
+
+		template <Color Us>
+		auto anyPawnMove(const BitboardSet &bbs, Bitboard pawns, Bitboard dstMask)
+		{
+			constexpr auto Them = oppColor(Us);
+
+			const auto pushes = pawns.template shiftUpRelative<Us>() & ~bbs.occupancy();
+			const auto captures = (pawns.template shiftUpLeftRelative<Us>()
+				| pawns.template shiftUpRightRelative<Us>()) & bbs.occupancy<Them>();
+
+			return !((pushes | captures) & dstMask).empty();
+		}
+
+		inline auto anyPawnMove(const Position &pos, Bitboard pawns, Bitboard dstMask)
+		{
+			if (pos.toMove() == Color::Black)
+				return anyPawnMove<Color::Black>(pos.bbs(), pawns, dstMask);
+			else return anyPawnMove<Color::White>(pos.bbs(), pawns, dstMask);
+		}
+
+		// Only rooks are sliders in shatranj, so pins are always orthogonal and a
+		// pinned piece can only move along the line through its king. Ferzes,
+		// alfils and knights never can, which leaves pinned rooks and pawn pushes.
+		// A pinned piece can also never resolve a check, so in check only
+		// unpinned pieces and the king are generated
+		template <bool Noisy, bool Quiet>
+		auto generateLegal_(ScoredMoveList &dst, const Position &pos)
+		{
+			const auto &bbs = pos.bbs();
+
+			const auto us = pos.toMove();
+			const auto them = oppColor(us);
+
+			const auto ours = bbs.forColor(us);
+			const auto theirs = bbs.forColor(them);
+
+			const auto occ = ours | theirs;
+
+			const auto king = pos.king(us);
+
+			Bitboard dstMask{};
+
+			if constexpr (Noisy)
+				dstMask |= theirs;
+			if constexpr (Quiet)
+				dstMask |= ~occ;
+
+			const auto kingDstMask = dstMask & ~kingDanger(pos);
+
+			const auto checkers = pos.checkers();
+
+			if (checkers.multiple())
+			{
+				generateKings(dst, pos, kingDstMask);
+				return;
+			}
+
+			// promotions are noisy
+			const auto promos = ~occ & (us == Color::Black ? boards::Rank1 : boards::Rank8);
+
+			auto pawnNoisyDstMask = theirs | promos;
+
+			if (!checkers.empty())
+			{
+				const auto checkMask = checkers | orthoRayBetween(king, checkers.lowestSquare());
+
+				dstMask &= checkMask;
+				pawnNoisyDstMask &= checkMask;
+			}
+
+			const auto pinned = pos.pinned();
+			const auto unpinned = ~pinned;
+
+			generateAlfils(dst, pos, dstMask, unpinned);
+			generateFerzes(dst, pos, dstMask, unpinned);
+			generateRooks(dst, pos, dstMask, unpinned);
+
+			if constexpr (Noisy)
+				generatePawnsNoisy(dst, pos, pawnNoisyDstMask, unpinned);
+			if constexpr (Quiet)
+				generatePawnsQuiet(dst, pos, dstMask, occ, unpinned);
+
+			generateKnights(dst, pos, dstMask, unpinned);
+			generateKings(dst, pos, kingDstMask);
+
+			if (!checkers.empty())
+				return;
+
+			auto pinnedMovers = pinned & (bbs.rooks(us) | bbs.pawns(us));
+			while (!pinnedMovers.empty())
+			{
+				const auto src = pinnedMovers.popLowestSquare();
+				const auto srcMask = Bitboard::fromSquare(src);
+
+				const auto line = orthoRayIntersecting(king, src);
+
+				generateRooks(dst, pos, dstMask & line, srcMask);
+
+				if constexpr (Noisy)
+					generatePawnsNoisy(dst, pos, pawnNoisyDstMask & line, srcMask);
+				if constexpr (Quiet)
+					generatePawnsQuiet(dst, pos, dstMask & line, occ, srcMask);
+			}
+		}
 	}
 
 	auto generateNoisy(ScoredMoveList &noisy, const Position &pos) -> void
@@ -282,4 +413,104 @@ namespace oranj
 		generateKnights(dst, pos, dstMask);
 		generateKings(dst, pos, kingDstMask);
 	}
+
+	auto generateLegal(ScoredMoveList &dst, const Position &pos) -> void
+	{
+		generateLegal_<true, true>(dst, pos);
+	}
+
+	auto generateEvasionsNoisy(ScoredMoveList &noisy, const Position &pos) -> void
+	{
+		assert(pos.isCheck());
+		generateLegal_<true, false>(noisy, pos);
+	}
+
+	auto generateEvasionsQuiet(ScoredMoveList &quiet, const Position &pos) -> void
+	{
+		assert(pos.isCheck());
+		generateLegal_<false, true>(quiet, pos);
+	}
+
+	auto hasLegalMove(const Position &pos) -> bool
+	{
+		const auto &bbs = pos.bbs();
+
+		const auto us = pos.toMove();
+
+		const auto ours = bbs.forColor(us);
+
+		const auto king = pos.king(us);
+
+		// the king is the piece most likely to have a move, and the only one in double check
+		if (!(attacks::getKingAttacks(king) & ~ours & ~kingDanger(pos)).empty())
+			return true;
+
+		const auto checkers = pos.checkers();
+
+		if (checkers.multiple())
+			return false;
+
+		auto dstMask = ~ours;
+
+		if (!checkers.empty())
+			dstMask &= checkers | orthoRayBetween(king, checkers.lowestSquare());
+
+		const auto pinned = pos.pinned();
+		const auto unpinned = ~pinned;
+
+		const auto anyLeaperMove = [&](Bitboard pieces, const std::array<Bitboard, 64> &attacks)
+		{
+			pieces &= unpinned;
+
+			while (!pieces.empty())
+			{
+				const auto src = pieces.popLowestSquare();
+
+				if (!(attacks[static_cast<usize>(src)] & dstMask).empty())
+					return true;
+			}
+
+			return false;
+		};
+
+		if (anyLeaperMove(bbs.knights(us), attacks::KnightAttacks)
+			|| anyLeaperMove(bbs.ferzes(us), attacks::FerzAttacks)
+			|| anyLeaperMove(bbs.alfils(us), attacks::AlfilAttacks))
+			return true;
+
+		if (anyPawnMove(pos, bbs.pawns(us) & unpinned, dstMask))
+			return true;
+
+		const auto occ = bbs.occupancy();
+
+		auto rooks = bbs.rooks(us) & unpinned;
+		while (!rooks.empty())
+		{
+			const auto src = rooks.popLowestSquare();
+
+			if (!(attacks::getRookAttacks(src, occ) & dstMask).empty())
+				return true;
+		}
+
+		// see generateLegal_()
+		if (!checkers.empty())
+			return false;
+
+		auto pinnedMovers = pinned & (bbs.rooks(us) | bbs.pawns(us));
+		while (!pinnedMovers.empty())
+		{
+			const auto src = pinnedMovers.popLowestSquare();
+			const auto line = orthoRayIntersecting(king, src);
+
+			if (bbs.rooks(us)[src])
+			{
+				if (!(attacks::getRookAttacks(src, occ) & dstMask & line).empty())
+					return true;
+			}
+			else if (anyPawnMove(pos, Bitboard::fromSquare(src), dstMask & line))
+				return true;
+		}
+
+		return false;
+	}
 }
@@ -37,4 +37,15 @@ namespace oranj
 	auto generateQuiet(ScoredMoveList &quiet, const Position &pos) -> void;
 
 	auto generateAll(ScoredMoveList &dst, const Position &pos) -> void;
+
+	// Fully legal generation, no Position::isLegal() filtering required
+	auto generateLegal(ScoredMoveList &dst, const Position &pos) -> void;
+
+	// Legal moves out of check, split the same way as generateNoisy()
+	// and generateQuiet(). Only valid when the side to move is in check
+	auto generateEvasionsNoisy(ScoredMoveList &noisy, const Position &pos) -> void;
+	auto generateEvasionsQuiet(ScoredMoveList &quiet, const Position &pos) -> void;
+
+	// Stops at the first legal move found, without generating a move list
+	[[nodiscard]] auto hasLegalMove(const Position &pos) -> bool;
 }
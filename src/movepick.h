@@ -231,7 +231,7 @@ namespace oranj
 
 			case MovegenStage::QsearchEvasionsGenNoisy:
 			{
-				generateNoisy(m_data.moves, m_pos);
+				generateEvasionsNoisy(m_data.moves, m_pos);
 				m_end = m_data.moves.size();
 				scoreNoisies();
 
@@ -252,7 +252,7 @@ namespace oranj
 			{
 				if (!m_skipQuiets)
 				{
-					generateQuiet(m_data.moves, m_pos);
+					generateEvasionsQuiet(m_data.moves, m_pos);
 					m_end = m_data.moves.size();
 					scoreQuiets();
 				}
@@ -36,6 +36,9 @@ namespace oranj
 		{
 			u32 threads{DefaultThreadCount};
 
+			// informational only, go ponder works regardless
+			bool ponder{false};
+
 			bool chess960{false};
 			bool showWdl{true};
 			bool showCurrMove{false};
@@ -45,6 +48,8 @@ namespace oranj
 
 			bool enableWeirdTcs{false};
 
+			bool deterministic{false};
+
 			i32 contempt{wdl::unnormalizeScoreMaterial58(DefaultNormalizedContempt)};
 		};
 
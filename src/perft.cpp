@@ -19,10 +19,24 @@
 #include "perft.h"
 
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <array>
+#include <numeric>
+#include <string_view>
 
 #include "movegen.h"
 #include "uci.h"
 #include "util/timer.h"
+#include "util/split.h"
+#include "util/parse.h"
+#include "opts.h"
 
 namespace oranj
 {
@@ -30,68 +44,544 @@ namespace oranj
 
 	namespace
 	{
-		auto doPerft(Position &pos, i32 depth) -> usize
+		// Lockless, always-replace. Depth is packed into the top byte of the
+		// count, and the key is stored xored with the data so that torn
+		// writes from another thread fail verification instead of returning
+		// garbage
+		class PerftTable
+		{
+		public:
+			explicit PerftTable(usize mib)
+				: m_entryCount{std::max<usize>(mib * 1024 * 1024 / sizeof(Entry), 1)},
+				  m_entries{std::make_unique<Entry[]>(m_entryCount)} {}
+
+			[[nodiscard]] inline auto probe(u64 key, i32 depth, usize &nodes) const -> bool
+			{
+				const auto &entry = m_entries[index(key)];
+
+				const auto data = entry.data.load(std::memory_order::relaxed);
+				const auto check = entry.check.load(std::memory_order::relaxed);
+
+				if ((check ^ data) != key
+					|| static_cast<i32>(data >> CountBits) != depth)
+					return false;
+
+				nodes = static_cast<usize>(data & CountMask);
+				return true;
+			}
+
+			inline auto store(u64 key, i32 depth, usize nodes) -> void
+			{
+				if (nodes > CountMask)
+					return;
+
+				auto &entry = m_entries[index(key)];
+
+				const auto data = (static_cast<u64>(depth) << CountBits) | static_cast<u64>(nodes);
+
+				entry.data.store(data, std::memory_order::relaxed);
+				entry.check.store(key ^ data, std::memory_order::relaxed);
+			}
+
+		private:
+			static constexpr i32 CountBits = 56;
+			static constexpr u64 CountMask = (U64(1) << CountBits) - 1;
+
+			struct Entry
+			{
+				std::atomic<u64> check{};
+				std::atomic<u64> data{};
+			};
+
+			[[nodiscard]] inline auto index(u64 key) const -> usize
+			{
+				return static_cast<usize>((static_cast<u128>(key) * static_cast<u128>(m_entryCount)) >> 64);
+			}
+
+			usize m_entryCount;
+			std::unique_ptr<Entry[]> m_entries;
+		};
+
+		auto doPerft(Position &pos, i32 depth, PerftTable *table) -> usize
 		{
 			if (depth == 0)
 				return 1;
 
-			--depth;
-
 			ScoredMoveList moves{};
-			generateAll(moves, pos);
+			generateLegal(moves, pos);
+
+			// bulk counting, the move list is fully legal
+			if (depth == 1)
+				return moves.size();
+
+			const auto key = pos.key();
 
 			usize total{};
 
+			if (table && table->probe(key, depth, total))
+				return total;
+
 			for (const auto [move, score] : moves)
 			{
-				if (!pos.isLegal(move))
+				const auto guard = pos.applyMove<false>(move, nullptr);
+				total += doPerft(pos, depth - 1, table);
+			}
+
+			if (table)
+				table->store(key, depth, total);
+
+			return total;
+		}
+
+		// counts for each legal root move, in generation order
+		auto rootPerft(const Position &pos, i32 depth, u32 threadCount, usize hashMib)
+		{
+			assert(depth > 0);
+
+			ScoredMoveList moves{};
+			generateLegal(moves, pos);
+
+			std::vector<std::pair<Move, usize>> results{};
+			results.reserve(moves.size());
+
+			for (const auto [move, score] : moves)
+			{
+				results.emplace_back(move, 0);
+			}
+
+			if (depth == 1)
+			{
+				for (auto &[move, count] : results)
+				{
+					count = 1;
+				}
+
+				return results;
+			}
+
+			std::unique_ptr<PerftTable> table{};
+
+			if (hashMib > 0)
+				table = std::make_unique<PerftTable>(hashMib);
+
+			std::atomic<usize> next{0};
+
+			const auto worker = [&]
+			{
+				Position threadPos{};
+				threadPos.copyStateFrom(pos);
+
+				usize idx;
+				while ((idx = next.fetch_add(1, std::memory_order::relaxed)) < results.size())
+				{
+					auto &[move, count] = results[idx];
+
+					const auto guard = threadPos.applyMove<false>(move, nullptr);
+					count = doPerft(threadPos, depth - 1, table.get());
+				}
+			};
+
+			threadCount = std::clamp<u32>(threadCount, 1, std::max<u32>(static_cast<u32>(results.size()), 1));
+
+			if (threadCount == 1)
+				worker();
+			else
+			{
+				std::vector<std::thread> threads{};
+				threads.reserve(threadCount);
+
+				for (u32 i = 0; i < threadCount; ++i)
+				{
+					threads.emplace_back(worker);
+				}
+
+				for (auto &thread : threads)
+				{
+					thread.join();
+				}
+			}
+
+			return results;
+		}
+
+		// counts from the pseudolegal generator + isLegal() filtering
+		const auto DefaultSuite = std::array{
+			"startpos ;D1 16 ;D2 256 ;D3 4176 ;D4 68122 ;D5 1164248 ;D6 19864709 ;D7 357218656",
+			"dfrc 123456 ;D1 13 ;D2 182 ;D3 2590 ;D4 39035 ;D5 606544",
+			"dfrc 500000 ;D1 13 ;D2 195 ;D3 2745 ;D4 43551 ;D5 666261",
+			"dfrc 921599 ;D1 14 ;D2 196 ;D3 2926 ;D4 43685 ;D5 707648",
+			"4k3/8/8/8/8/8/8/4K3 w - - 0 1 ;D1 5 ;D2 25 ;D3 170 ;D4 1156 ;D5 7922 ;D6 53896",
+			"8/8/8/3k4/8/8/8/R3K3 w - - 0 1 ;D1 15 ;D2 107 ;D3 1943 ;D4 12876 ;D5 240590",
+			"8/3P4/8/8/8/8/3k4/K7 w - - 0 1 ;D1 4 ;D2 27 ;D3 148 ;D4 898 ;D5 5637 ;D6 38003",
+			"4k3/8/8/8/8/8/1p6/R3K3 b - - 0 1 ;D1 7 ;D2 93 ;D3 670 ;D4 10783 ;D5 77644",
+			"3rk3/8/8/8/1r2R1K1/8/8/8 b - - 0 1 ;D1 4 ;D2 42 ;D3 998 ;D4 13445 ;D5 333170",
+			"8/1P6/8/4k3/8/8/5p2/3RK2r w - - 0 1 ;D1 3 ;D2 53 ;D3 826 ;D4 14078 ;D5 236673",
+			"8/8/2r5/8/2K1Q2r/8/8/4k3 w - - 0 1 ;D1 6 ;D2 172 ;D3 1134 ;D4 32550 ;D5 235847",
+			"8/8/8/8/r1P1K2r/8/8/k7 w - - 0 1 ;D1 6 ;D2 138 ;D3 832 ;D4 21222 ;D5 133493",
+			"4r3/8/8/4P3/r3K3/4R3/8/k7 w - - 0 1 ;D1 4 ;D2 104 ;D3 1263 ;D4 28796 ;D5 429199",
+			"8/8/4k3/8/4r3/8/4P3/r2NK3 w - - 0 1 ;D1 4 ;D2 111 ;D3 786 ;D4 23307 ;D5 196372",
+			"r4bnr/pppkpp1p/2np2p1/8/2b5/B1N4P/PPPPPPP1/R2KQ1NR b - - 0 1 ;D1 28 ;D2 508 ;D3 13667 ;D4 258947 ;D5 6687570"
+		};
+
+		struct SuitePosition
+		{
+			std::string name;
+			Position pos;
+		};
+
+		struct SuiteCase
+		{
+			usize position;
+			i32 depth;
+			usize expected;
+			usize nodes{};
+			f64 time{};
+		};
+
+		auto parseSuiteLine(const std::string &line, i32 maxDepth,
+			std::vector<SuitePosition> &positions, std::vector<SuiteCase> &cases) -> bool
+		{
+			const auto fields = split::split(line, ';');
+
+			if (fields.empty())
+				return true;
+
+			auto name = fields[0];
+
+			name.erase(0, name.find_first_not_of(" \t"));
+			name.erase(name.find_last_not_of(" \t\r") + 1);
+
+			if (name.empty())
+				return true;
+
+			auto &[_, pos] = positions.emplace_back(name, Position{});
+
+			if (name == "startpos")
+				pos.resetToStarting();
+			else if (name.starts_with("dfrc "))
+			{
+				const auto index = util::tryParseU32(name.substr(5));
+				if (!index || !pos.resetFromDfrcIndex(*index))
+				{
+					std::cerr << "invalid dfrc index in \"" << line << '"' << std::endl;
+					return false;
+				}
+			}
+			else if (!pos.resetFromFen(name))
+				return false;
+
+			for (usize i = 1; i < fields.size(); ++i)
+			{
+				std::istringstream stream{fields[i]};
+
+				std::string depthStr{};
+				std::string nodesStr{};
+
+				stream >> depthStr >> nodesStr;
+
+				if (depthStr.empty())
 					continue;
 
-				if (depth == 0)
-					++total;
-				else
+				i32 depth{};
+				u64 nodes{};
+
+				if (depthStr[0] != 'D'
+					|| !util::tryParseI32(depth, depthStr.substr(1)) || depth < 1
+					|| !util::tryParseU64(nodes, nodesStr))
 				{
-					const auto guard = pos.applyMove<false>(move, nullptr);
-					total += doPerft(pos, depth);
+					std::cerr << "invalid perft count \"" << fields[i] << "\" in \"" << line << '"' << std::endl;
+					return false;
 				}
+
+				if (depth <= maxDepth)
+					cases.push_back({positions.size() - 1, depth, static_cast<usize>(nodes)});
 			}
 
-			return total;
+			return true;
+		}
+
+		auto runSuiteCases(std::vector<SuitePosition> &positions, std::vector<SuiteCase> &cases, u32 threadCount)
+		{
+			// largest first, so that one long case does not end up last
+			std::vector<usize> order(cases.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::ranges::stable_sort(order, [&](usize a, usize b) { return cases[a].expected > cases[b].expected; });
+
+			std::atomic<usize> next{0};
+
+			const auto worker = [&]
+			{
+				Position pos{};
+
+				usize idx;
+				while ((idx = next.fetch_add(1, std::memory_order::relaxed)) < order.size())
+				{
+					auto &suiteCase = cases[order[idx]];
+
+					pos.copyStateFrom(positions[suiteCase.position].pos);
+
+					const auto start = Instant::now();
+					suiteCase.nodes = doPerft(pos, suiteCase.depth, nullptr);
+					suiteCase.time = start.elapsed();
+				}
+			};
+
+			std::vector<std::thread> threads{};
+			threads.reserve(threadCount);
+
+			for (u32 i = 0; i < threadCount; ++i)
+			{
+				threads.emplace_back(worker);
+			}
+
+			for (auto &thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		auto collectNodes(Position &pos, i32 depth, std::vector<std::string> &fens) -> void
+		{
+			fens.push_back(pos.toFen());
+
+			if (depth == 0)
+				return;
+
+			ScoredMoveList moves{};
+			generateLegal(moves, pos);
+
+			for (const auto [move, score] : moves)
+			{
+				const auto guard = pos.applyMove<false>(move, nullptr);
+				collectNodes(pos, depth - 1, fens);
+			}
+		}
+
+		// Each position is timed over several repetitions, so that
+		// the cost of reading the clock does not dominate
+		auto benchMovegen(const std::vector<SuitePosition> &positions) -> void
+		{
+			static constexpr i32 SampleDepth = 2;
+			static constexpr usize Repetitions = 64;
+
+			std::vector<std::string> fens{};
+
+			for (const auto &[name, root] : positions)
+			{
+				Position pos{};
+				pos.copyStateFrom(root);
+
+				collectNodes(pos, SampleDepth, fens);
+			}
+
+			f64 generateTime{};
+			f64 isLegalTime{};
+			f64 applyTime{};
+
+			usize generated{};
+			usize legal{};
+			usize applied{};
+
+			Position pos{};
+
+			ScoredMoveList moves{};
+			ScoredMoveList legalMoves{};
+
+			for (const auto &fen : fens)
+			{
+				pos.resetFromFen(fen);
+
+				auto start = Instant::now();
+
+				for (usize i = 0; i < Repetitions; ++i)
+				{
+					moves.clear();
+					generateAll(moves, pos);
+				}
+
+				generateTime += start.elapsed();
+				generated += moves.size() * Repetitions;
+
+				usize legalCount{};
+
+				start = Instant::now();
+
+				for (usize i = 0; i < Repetitions; ++i)
+				{
+					for (const auto [move, score] : moves)
+					{
+						legalCount += pos.isLegal(move);
+					}
+				}
+
+				isLegalTime += start.elapsed();
+				legal += legalCount;
+
+				legalMoves.clear();
+				generateLegal(legalMoves, pos);
+
+				start = Instant::now();
+
+				for (usize i = 0; i < Repetitions; ++i)
+				{
+					for (const auto [move, score] : legalMoves)
+					{
+						const auto guard = pos.applyMove<false>(move, nullptr);
+					}
+				}
+
+				applyTime += start.elapsed();
+				applied += legalMoves.size() * Repetitions;
+			}
+
+			const auto totalGenerateCalls = fens.size() * Repetitions;
+			const auto totalIsLegalCalls = generated;
+
+			const auto report = [](std::string_view name, usize calls, f64 time, std::string_view extra)
+			{
+				std::cout << std::left << std::setw(12) << name << std::right
+					<< std::setw(10) << std::fixed << std::setprecision(1)
+					<< time * 1e9 / static_cast<f64>(std::max<usize>(calls, 1)) << " ns/call  "
+					<< std::setw(8) << std::setprecision(2)
+					<< static_cast<f64>(calls) / time / 1e6 << " M calls/s" << extra
+					<< std::defaultfloat << '\n';
+			};
+
+			std::cout << "\nmovegen timing over " << fens.size() << " positions, "
+				<< Repetitions << " repetitions each\n";
+
+			report("generateAll", totalGenerateCalls, generateTime, "");
+			report("isLegal", totalIsLegalCalls, isLegalTime, "");
+			report("applyMove", applied, applyTime, " (make + unmake)");
+
+			std::cout << "legal moves: " << legal << " of " << generated << " generated" << std::endl;
 		}
 	}
 
-	auto perft(Position &pos, i32 depth) -> void
+	auto perft(const Position &pos, i32 depth, u32 threads, usize hashMib) -> void
 	{
-		std::cout << doPerft(pos, depth) << std::endl;
+		if (depth <= 0)
+		{
+			std::cout << 1 << std::endl;
+			return;
+		}
+
+		usize total{};
+
+		for (const auto [move, count] : rootPerft(pos, depth, threads, hashMib))
+		{
+			total += count;
+		}
+
+		std::cout << total << std::endl;
 	}
 
-	auto splitPerft(Position &pos, i32 depth) -> void
+	auto splitPerft(const Position &pos, i32 depth, u32 threads, usize hashMib) -> void
 	{
-		--depth;
+		if (depth <= 0)
+		{
+			std::cout << "\ntotal 1" << std::endl;
+			return;
+		}
 
 		const auto start = Instant::now();
 
-		ScoredMoveList moves{};
-		generateAll(moves, pos);
+		const auto results = rootPerft(pos, depth, threads, hashMib);
+
+		const auto time = start.elapsed();
 
 		usize total{};
 
-		for (const auto [move, score] : moves)
+		for (const auto [move, count] : results)
+		{
+			total += count;
+			std::cout << uci::moveToString(move) << '\t' << count << '\n';
+		}
+
+		const auto nps = static_cast<usize>(static_cast<f64>(total) / time);
+
+		std::cout << "\ntotal " << total << '\n';
+		std::cout << "time " << std::fixed << std::setprecision(3) << time << " s" << std::defaultfloat << '\n';
+		std::cout << nps << " nps" << std::endl;
+	}
+
+	auto perftSuite(const std::optional<std::string> &epdFile, u32 threads, i32 maxDepth) -> bool
+	{
+		// dfrc positions need this for resetFromDfrcIndex()
+		opts::mutableOpts().chess960 = true;
+
+		std::vector<SuitePosition> positions{};
+		std::vector<SuiteCase> cases{};
+
+		if (epdFile)
+		{
+			std::ifstream stream{*epdFile};
+
+			if (!stream)
+			{
+				std::cerr << "failed to open " << *epdFile << std::endl;
+				return false;
+			}
+
+			for (std::string line{}; std::getline(stream, line);)
+			{
+				if (!parseSuiteLine(line, maxDepth, positions, cases))
+					return false;
+			}
+		}
+		else
+		{
+			for (const std::string line : DefaultSuite)
+			{
+				if (!parseSuiteLine(line, maxDepth, positions, cases))
+					return false;
+			}
+		}
+
+		if (cases.empty())
+		{
+			std::cerr << "no perft counts to check" << std::endl;
+			return false;
+		}
+
+		threads = std::clamp<u32>(threads, 1, static_cast<u32>(cases.size()));
+
+		std::cout << "running " << cases.size() << " perft counts from " << positions.size()
+			<< " positions on " << threads << " thread" << (threads == 1 ? "" : "s") << std::endl;
+
+		const auto start = Instant::now();
+
+		runSuiteCases(positions, cases, threads);
+
+		const auto time = start.elapsed();
+
+		usize passed{};
+		usize totalNodes{};
+
+		for (const auto &suiteCase : cases)
 		{
-			if (!pos.isLegal(move))
-				continue;
+			const auto ok = suiteCase.nodes == suiteCase.expected;
+
+			if (ok)
+				++passed;
+
+			totalNodes += suiteCase.nodes;
 
-			const auto guard = pos.applyMove<false>(move, nullptr);
+			std::cout << (ok ? "pass " : "FAIL ") << positions[suiteCase.position].name
+				<< " depth " << suiteCase.depth << ": " << suiteCase.nodes;
 
-			const auto value = doPerft(pos, depth);
+			if (!ok)
+				std::cout << " (expected " << suiteCase.expected << ")";
 
-			total += value;
-			std::cout << uci::moveToString(move) << '\t' << value << '\n';
+			std::cout << '\n';
 		}
 
-		const auto nps = static_cast<usize>(static_cast<f64>(total) / start.elapsed());
+		std::cout << '\n' << passed << " of " << cases.size() << " passed\n";
+		std::cout << totalNodes << " nodes in " << std::fixed << std::setprecision(3) << time << " s, "
+			<< std::defaultfloat << static_cast<usize>(static_cast<f64>(totalNodes) / time) << " nps" << std::endl;
 
-		std::cout << "\ntotal " << total << '\n';
-		std::cout << nps << " nps" << std::endl;
+		benchMovegen(positions);
+
+		return passed == cases.size();
 	}
 }
@@ -20,11 +20,22 @@
 
 #include "types.h"
 
+#include <string>
+#include <optional>
+
 #include "core.h"
 #include "position/position.h"
 
 namespace oranj
 {
-	auto perft(Position &pos, i32 depth) -> void;
-	auto splitPerft(Position &pos, i32 depth) -> void;
+	// threads split the root moves between them, hashMib > 0
+	// enables a transposition table shared between threads
+	auto perft(const Position &pos, i32 depth, u32 threads = 1, usize hashMib = 0) -> void;
+	auto splitPerft(const Position &pos, i32 depth, u32 threads = 1, usize hashMib = 0) -> void;
+
+	// Checks every "<position> ;D<depth> <nodes> ..." line of an EPD file against
+	// perft, or the built-in suite if no file is given. Positions are "startpos",
+	// "dfrc <index>" or a FEN. Depths above maxDepth are skipped. Afterwards,
+	// times generateAll(), isLegal() and applyMove() on positions from the suite
+	auto perftSuite(const std::optional<std::string> &epdFile, u32 threads, i32 maxDepth) -> bool;
 }
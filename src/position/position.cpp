@@ -25,11 +25,12 @@
 #include "../pretty.h"
 #endif
 #include <algorithm>
-#include <sstream>
+#include <array>
+#include <charconv>
+#include <span>
 #include <cassert>
 
 #include "../util/parse.h"
-#include "../util/split.h"
 #include "../attacks/attacks.h"
 #include "../movegen.h"
 #include "../opts.h"
@@ -114,6 +115,52 @@ namespace oranj
 
 			return dst;
 		}
+
+		// splits str on delim without allocating, skipping empty tokens like split::split().
+		// Returns the total number of tokens, which may be more than fit in dst
+		auto splitInto(std::string_view str, char delim, std::span<std::string_view> dst) -> usize
+		{
+			usize count = 0;
+			usize begin = 0;
+
+			while (begin < str.size())
+			{
+				auto end = str.find(delim, begin);
+
+				if (end == std::string_view::npos)
+					end = str.size();
+
+				if (end > begin)
+				{
+					if (count < dst.size())
+						dst[count] = str.substr(begin, end - begin);
+					++count;
+				}
+
+				begin = end + 1;
+			}
+
+			return count;
+		}
+
+		[[nodiscard]] auto parseFenNumber(std::string_view str) -> std::optional<u32>
+		{
+			u32 value{};
+
+			const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+
+			if (ec != std::errc{} || end != str.data() + str.size())
+				return {};
+
+			return value;
+		}
+
+		auto appendNumber(std::string &dst, u32 value)
+		{
+			std::array<char, 16> buf{};
+			const auto [end, _ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+			dst.append(buf.data(), end);
+		}
 	}
 
 	template auto Position::applyMoveUnchecked<false, false>(Move, eval::NnueState *) -> void;
@@ -148,13 +195,18 @@ namespace oranj
 		m_states.reserve(256);
 		m_keys.reserve(512);
 
+#if OJ_UNDO_LOG
+		m_undo.reserve(256);
+#endif
+
 		m_states.push_back({});
 	}
 
 	auto Position::resetToStarting() -> void
 	{
 		m_states.resize(1);
-		m_keys.clear();
+		clearKeyHistory();
+		clearUndoLog();
 
 		auto &state = currState();
 		state = BoardState{};
@@ -177,47 +229,51 @@ namespace oranj
 		regen();
 	}
 
-	auto Position::resetFromFen(const std::string &fen) -> bool
+	auto Position::resetFromFen(std::string_view fen) -> bool
 	{
-		const auto tokens = split::split(fen, ' ');
+		if (const auto end = fen.find_last_not_of(" \t\r\n"); end != std::string_view::npos)
+			fen = fen.substr(0, end + 1);
+
+		std::array<std::string_view, 6> tokens{};
+		const auto tokenCount = splitInto(fen, ' ', tokens);
 
-		if (tokens.size() > 6)
+		if (tokenCount > 6)
 		{
 			std::cerr << "excess tokens after fullmove number in fen " << fen << std::endl;
 			return false;
 		}
 
-		if (tokens.size() == 5)
+		if (tokenCount == 5)
 		{
 			std::cerr << "missing fullmove number in fen " << fen << std::endl;
 			return false;
 		}
 
-		if (tokens.size() == 4)
+		if (tokenCount == 4)
 		{
 			std::cerr << "missing halfmove clock in fen " << fen << std::endl;
 			return false;
 		}
 
-		if (tokens.size() == 3)
+		if (tokenCount == 3)
 		{
 			std::cerr << "missing fourth field in fen " << fen << std::endl;
 			return false;
 		}
 
-		if (tokens.size() == 2)
+		if (tokenCount == 2)
 		{
 			std::cerr << "missing third field in fen " << fen << std::endl;
 			return false;
 		}
 
-		if (tokens.size() == 1)
+		if (tokenCount == 1)
 		{
 			std::cerr << "missing next move color in fen " << fen << std::endl;
 			return false;
 		}
 
-		if (tokens.empty())
+		if (tokenCount == 0)
 		{
 			std::cerr << "missing ranks in fen " << fen << std::endl;
 			return false;
@@ -226,17 +282,25 @@ namespace oranj
 		BoardState newState{};
 		auto &newBbs = newState.boards.bbs();
 
-		u32 rankIdx = 0;
+		std::array<std::string_view, 8> ranks{};
+		const auto rankCount = splitInto(tokens[0], '/', ranks);
 
-		const auto ranks = split::split(tokens[0], '/');
-		for (const auto &rank : ranks)
+		if (rankCount > 8)
 		{
-			if (rankIdx >= 8)
-			{
-				std::cerr << "too many ranks in fen " << fen << std::endl;
-				return false;
-			}
+			std::cerr << "too many ranks in fen " << fen << std::endl;
+			return false;
+		}
+
+		if (rankCount < 8)
+		{
+			std::cerr << "not enough ranks in fen " << fen << std::endl;
+			return false;
+		}
 
+		u32 rankIdx = 0;
+
+		for (const auto rank : ranks)
+		{
 			u32 fileIdx = 0;
 
 			for (const auto c : rank)
@@ -297,7 +361,7 @@ namespace oranj
 			return false;
 		}
 
-		const auto &color = tokens[1];
+		const auto color = tokens[1];
 
 		if (color.length() != 1)
 		{
@@ -337,9 +401,7 @@ namespace oranj
 			return false;
 		}
 
-		const auto &halfmoveStr = tokens[4];
-
-		if (const auto halfmove = util::tryParseU32(halfmoveStr))
+		if (const auto halfmove = parseFenNumber(tokens[4]))
 			newState.halfmove = *halfmove;
 		else
 		{
@@ -347,11 +409,9 @@ namespace oranj
 			return false;
 		}
 
-		const auto &fullmoveStr = tokens[5];
-
 		u32 newFullmove;
 
-		if (const auto fullmove = util::tryParseU32(fullmoveStr))
+		if (const auto fullmove = parseFenNumber(tokens[5]))
 			newFullmove = *fullmove;
 		else
 		{
@@ -360,7 +420,8 @@ namespace oranj
 		}
 
 		m_states.resize(1);
-		m_keys.clear();
+		clearKeyHistory();
+		clearUndoLog();
 
 		m_blackToMove = newBlackToMove;
 		m_fullmove = newFullmove;
@@ -383,7 +444,8 @@ namespace oranj
 		}
 
 		m_states.resize(1);
-		m_keys.clear();
+		clearKeyHistory();
+		clearUndoLog();
 
 		auto &state = currState();
 		state = BoardState{};
@@ -425,7 +487,8 @@ namespace oranj
 		}
 
 		m_states.resize(1);
-		m_keys.clear();
+		clearKeyHistory();
+		clearUndoLog();
 
 		auto &state = currState();
 		state = BoardState{};
@@ -460,7 +523,8 @@ namespace oranj
 	auto Position::copyStateFrom(const Position &other) -> void
 	{
 		m_states.clear();
-		m_keys.clear();
+		clearKeyHistory();
+		clearUndoLog();
 
 		m_states.push_back(other.currState());
 
@@ -476,13 +540,29 @@ namespace oranj
 
 		auto &prevState = currState();
 
+#if OJ_UNDO_LOG
+		if constexpr (StateHistory)
+		{
+			assert(m_undo.size() < m_undo.capacity());
+			m_undo.push_back({
+				.checkers = prevState.checkers,
+				.pinned = prevState.pinned,
+				.threats = prevState.threats,
+				.halfmove = prevState.halfmove,
+				.move = move,
+				.threatsValid = prevState.threatsValid
+			});
+		}
+#else
 		if constexpr (StateHistory)
 		{
 			assert(m_states.size() < m_states.capacity());
 			m_states.push_back(prevState);
 		}
+#endif
 
 		m_keys.push_back(prevState.keys.all);
+		m_keyFilter.add(prevState.keys.all);
 
 		auto &state = currState();
 
@@ -498,7 +578,7 @@ namespace oranj
 		if (!move)
 		{
 			state.pinned = calcPinned();
-			state.threats = calcThreats();
+			state.threatsValid = false;
 
 			return;
 		}
@@ -525,6 +605,11 @@ namespace oranj
 
 		assert(pieceTypeOrNone(captured) != PieceType::King);
 
+#if OJ_UNDO_LOG
+		if constexpr (StateHistory)
+			m_undo.back().captured = captured;
+#endif
+
 		if constexpr (UpdateNnue)
 			nnueState->pushUpdates<!StateHistory>(updates, state.boards.bbs(), state.kings);
 
@@ -535,13 +620,17 @@ namespace oranj
 
 		state.checkers = calcCheckers();
 		state.pinned = calcPinned();
-		state.threats = calcThreats();
+		state.threatsValid = false;
 	}
 
 	template <bool UpdateNnue>
 	auto Position::popMove(eval::NnueState *nnueState) -> void
 	{
+#if OJ_UNDO_LOG
+		assert(!m_undo.empty() && "popMove() with no previous move?");
+#else
 		assert(m_states.size() > 1 && "popMove() with no previous move?");
+#endif
 
 		if constexpr (UpdateNnue)
 		{
@@ -549,7 +638,42 @@ namespace oranj
 			nnueState->pop();
 		}
 
+#if OJ_UNDO_LOG
+		const auto undo = m_undo.back();
+		m_undo.pop_back();
+
+		auto &state = currState();
+
+		if (const auto move = undo.move)
+		{
+			const auto src = move.src();
+			const auto dst = move.dst();
+
+			const auto moved = state.boards.pieceAt(dst);
+
+			if (move.type() == MoveType::Promotion)
+			{
+				removePiece(moved, dst);
+				setPiece(copyPieceColor(moved, PieceType::Pawn), src);
+			}
+			else movePieceNoCap(moved, dst, src);
+
+			if (undo.captured != Piece::None)
+				setPiece(undo.captured, dst);
+		}
+
+		state.keys.flipStm();
+
+		state.checkers = undo.checkers;
+		state.pinned = undo.pinned;
+		state.threats = undo.threats;
+		state.halfmove = undo.halfmove;
+		state.threatsValid = undo.threatsValid;
+#else
 		m_states.pop_back();
+#endif
+
+		m_keyFilter.remove(m_keys.back());
 		m_keys.pop_back();
 
 		m_blackToMove = !m_blackToMove;
@@ -563,6 +687,7 @@ namespace oranj
 		const auto state = currState();
 		m_states.resize(1);
 		currState() = state;
+		clearUndoLog();
 	}
 
 	auto Position::isPseudolegal(Move move) const -> bool
@@ -670,7 +795,7 @@ namespace oranj
 		{
 			const auto kinglessOcc = bbs.occupancy() ^ bbs.kings(us);
 
-			return !state.threats[move.dst()]
+			return !threatsOf(state, us)[move.dst()]
 				&& (attacks::getRookAttacks(dst, kinglessOcc) & bbs.rooks(them)).empty();
 		}
 
@@ -754,27 +879,25 @@ namespace oranj
 			if (!isCheck())
 				return true;
 
-			//TODO there's a speedup possible here, but
-			// it requires a lot of movegen refactoring
-			ScoredMoveList moves{};
-			generateAll(moves, *this);
-
-			return std::ranges::any_of(moves, [this](const auto move)
-			{
-				return isLegal(move.move);
-			});
+			// checkmate takes precedence
+			return hasLegalMove(*this);
 		}
 
 		const auto currKey = currState().keys.all;
-		const auto limit = std::max(0, static_cast<i32>(m_keys.size()) - halfmove - 2);
-
-		i32 repetitionsLeft = threefold ? 2 : 1;
 
-		for (auto i = static_cast<i32>(m_keys.size()) - 4; i >= limit; i -= 2)
+		// no need to scan the history if the key cannot be in it
+		if (m_keyFilter.mayContain(currKey))
 		{
-			if (m_keys[i] == currKey
-				&& --repetitionsLeft == 0)
-				return true;
+			const auto limit = std::max(0, static_cast<i32>(m_keys.size()) - halfmove - 2);
+
+			i32 repetitionsLeft = threefold ? 2 : 1;
+
+			for (auto i = static_cast<i32>(m_keys.size()) - 4; i >= limit; i -= 2)
+			{
+				if (m_keys[i] == currKey
+					&& --repetitionsLeft == 0)
+					return true;
+			}
 		}
 
 		const auto &bbs = this->bbs();
@@ -790,9 +913,17 @@ namespace oranj
 
 	auto Position::toFen() const -> std::string
 	{
-		const auto &state = currState();
+		std::string fen{};
+		fen.reserve(96);
 
-		std::ostringstream fen{};
+		writeFen(fen);
+
+		return fen;
+	}
+
+	auto Position::writeFen(std::string &dst) const -> void
+	{
+		const auto &state = currState();
 
 		for (i32 rank = 7; rank >= 0; --rank)
 		{
@@ -803,25 +934,87 @@ namespace oranj
 					u32 emptySquares = 1;
 					for (; file < 7 && state.boards.pieceAt(rank, file + 1) == Piece::None; ++file, ++emptySquares) {}
 
-					fen << static_cast<char>('0' + emptySquares);
+					dst += static_cast<char>('0' + emptySquares);
 				}
-				else fen << pieceToChar(state.boards.pieceAt(rank, file));
+				else dst += pieceToChar(state.boards.pieceAt(rank, file));
 			}
 
 			if (rank > 0)
-				fen << '/';
+				dst += '/';
+		}
+
+		dst += toMove() == Color::White ? " w " : " b ";
+
+		dst += " - -";
+
+		dst += ' ';
+		appendNumber(dst, state.halfmove);
+		dst += ' ';
+		appendNumber(dst, m_fullmove);
+	}
+
+#if OJ_INCREMENTAL_ATTACKS
+	namespace
+	{
+		inline auto pieceAttacks(Piece piece, Square square, Bitboard occupancy)
+		{
+			const auto type = pieceType(piece);
+
+			if (type == PieceType::Pawn)
+				return attacks::getPawnAttacks(square, pieceColor(piece));
+
+			return attacks::getNonPawnPieceAttacks(type, square, occupancy);
 		}
+	}
 
-		fen << (toMove() == Color::White ? " w " : " b ");
+	auto Position::liftAttacks(Bitboard changed) -> Bitboard
+	{
+		auto &state = currState();
+		const auto &bbs = state.boards.bbs();
+
+		const auto occ = bbs.occupancy();
+
+		// leapers only attack fixed squares, but any rook looking
+		// at a changed square may see further or less far after it
+		auto lifted = occ & changed;
+
+		auto squares = changed;
+		while (!squares.empty())
+		{
+			const auto square = squares.popLowestSquare();
+			lifted |= attacks::getRookAttacks(square, occ) & bbs.rooks();
+		}
 
-		fen << " - -";
+		auto pieces = lifted;
+		while (!pieces.empty())
+		{
+			const auto square = pieces.popLowestSquare();
+			const auto piece = state.boards.pieceAt(square);
 
-		fen << ' ' << state.halfmove;
-		fen << ' ' << m_fullmove;
+			state.attacks.sub(pieceColor(piece), pieceAttacks(piece, square, occ));
+		}
 
-		return fen.str();
+		return lifted;
 	}
 
+	auto Position::dropAttacks(Bitboard lifted, Bitboard changed) -> void
+	{
+		auto &state = currState();
+		const auto &bbs = state.boards.bbs();
+
+		const auto occ = bbs.occupancy();
+
+		auto pieces = (lifted | changed) & occ;
+		while (!pieces.empty())
+		{
+			const auto square = pieces.popLowestSquare();
+			const auto piece = state.boards.pieceAt(square);
+
+			state.attacks.add(pieceColor(piece), pieceAttacks(piece, square, occ));
+		}
+	}
+#endif
+
 	template <bool UpdateKey>
 	auto Position::setPiece(Piece piece, Square square) -> void
 	{
@@ -832,8 +1025,17 @@ namespace oranj
 
 		auto &state = currState();
 
+#if OJ_INCREMENTAL_ATTACKS
+		const auto changed = Bitboard::fromSquare(square);
+		const auto lifted = liftAttacks(changed);
+#endif
+
 		state.boards.setPiece(square, piece);
 
+#if OJ_INCREMENTAL_ATTACKS
+		dropAttacks(lifted, changed);
+#endif
+
 		if constexpr (UpdateKey)
 			state.keys.flipPiece(piece, square);
 	}
@@ -848,8 +1050,17 @@ namespace oranj
 
 		auto &state = currState();
 
+#if OJ_INCREMENTAL_ATTACKS
+		const auto changed = Bitboard::fromSquare(square);
+		const auto lifted = liftAttacks(changed);
+#endif
+
 		state.boards.removePiece(square, piece);
 
+#if OJ_INCREMENTAL_ATTACKS
+		dropAttacks(lifted, changed);
+#endif
+
 		if constexpr (UpdateKey)
 			state.keys.flipPiece(piece, square);
 	}
@@ -867,8 +1078,17 @@ namespace oranj
 
 		auto &state = currState();
 
+#if OJ_INCREMENTAL_ATTACKS
+		const auto changed = Bitboard::fromSquare(src) | Bitboard::fromSquare(dst);
+		const auto lifted = liftAttacks(changed);
+#endif
+
 		state.boards.movePiece(src, dst, piece);
 
+#if OJ_INCREMENTAL_ATTACKS
+		dropAttacks(lifted, changed);
+#endif
+
 		if (pieceType(piece) == PieceType::King)
 		{
 			const auto color = pieceColor(piece);
@@ -890,6 +1110,11 @@ namespace oranj
 
 		auto &state = currState();
 
+#if OJ_INCREMENTAL_ATTACKS
+		const auto changed = Bitboard::fromSquare(src) | Bitboard::fromSquare(dst);
+		const auto lifted = liftAttacks(changed);
+#endif
+
 		const auto captured = state.boards.pieceAt(dst);
 
 		if (captured != Piece::None)
@@ -906,6 +1131,10 @@ namespace oranj
 
 		state.boards.movePiece(src, dst, piece);
 
+#if OJ_INCREMENTAL_ATTACKS
+		dropAttacks(lifted, changed);
+#endif
+
 		if (pieceType(piece) == PieceType::King)
 		{
 			const auto color = pieceColor(piece);
@@ -948,6 +1177,11 @@ namespace oranj
 
 		auto &state = currState();
 
+#if OJ_INCREMENTAL_ATTACKS
+		const auto changed = Bitboard::fromSquare(src) | Bitboard::fromSquare(dst);
+		const auto lifted = liftAttacks(changed);
+#endif
+
 		const auto captured = state.boards.pieceAt(dst);
 
 		if (captured != Piece::None)
@@ -965,6 +1199,10 @@ namespace oranj
 
 		state.boards.moveAndChangePiece(src, dst, pawn, PieceType::Ferz);
 
+#if OJ_INCREMENTAL_ATTACKS
+		dropAttacks(lifted, changed);
+#endif
+
 		if constexpr(UpdateNnue || UpdateKey)
 		{
 			const auto coloredFerz = copyPieceColor(pawn, PieceType::Ferz);
@@ -993,6 +1231,11 @@ namespace oranj
 
 		state.keys.clear();
 
+#if OJ_INCREMENTAL_ATTACKS
+		state.attacks = {};
+		dropAttacks(Bitboard{}, state.boards.bbs().occupancy());
+#endif
+
 		for (u32 rank = 0; rank < 8; ++rank)
 		{
 			for (u32 file = 0; file < 8; ++file)
@@ -1013,7 +1256,7 @@ namespace oranj
 
 		state.checkers = calcCheckers();
 		state.pinned = calcPinned();
-		state.threats = calcThreats();
+		state.threatsValid = false;
 	}
 
 	auto Position::moveFromUci(const std::string &move) const -> Move
@@ -1044,7 +1287,7 @@ namespace oranj
 		return position;
 	}
 
-	auto Position::fromFen(const std::string &fen) -> std::optional<Position>
+	auto Position::fromFen(std::string_view fen) -> std::optional<Position>
 	{
 		Position position{};
 
@@ -20,7 +20,9 @@
 
 #include "../types.h"
 
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stack>
 #include <optional>
@@ -34,6 +36,18 @@
 #include "../rays.h"
 #include "../keys.h"
 
+// Unmake moves from a compact undo record instead of copying
+// the whole BoardState on every move, see UndoRecord below
+#ifndef OJ_UNDO_LOG
+	#define OJ_UNDO_LOG 0
+#endif
+
+// Maintain per-colour attack counts for every square as pieces move,
+// instead of recomputing threats and isAttacked() from the bitboards
+#ifndef OJ_INCREMENTAL_ATTACKS
+	#define OJ_INCREMENTAL_ATTACKS 0
+#endif
+
 namespace oranj
 {
 	struct Keys
@@ -99,6 +113,91 @@ namespace oranj
 		[[nodiscard]] inline auto operator==(const Keys &other) const -> bool = default;
 	};
 
+#if OJ_INCREMENTAL_ATTACKS
+	// Number of pieces of each colour attacking each square. Kept up to date by
+	// the Position piece primitives - see Position::liftAttacks()
+	struct AttackMap
+	{
+		std::array<std::array<u8, 64>, 2> counts{};
+
+		inline auto add(Color color, Bitboard squares)
+		{
+			auto &colorCounts = counts[static_cast<i32>(color)];
+
+			while (!squares.empty())
+			{
+				const auto square = squares.popLowestSquare();
+				++colorCounts[static_cast<i32>(square)];
+			}
+		}
+
+		inline auto sub(Color color, Bitboard squares)
+		{
+			auto &colorCounts = counts[static_cast<i32>(color)];
+
+			while (!squares.empty())
+			{
+				const auto square = squares.popLowestSquare();
+
+				assert(colorCounts[static_cast<i32>(square)] > 0);
+				--colorCounts[static_cast<i32>(square)];
+			}
+		}
+
+		[[nodiscard]] inline auto attacked(Color color, Square square) const
+		{
+			return counts[static_cast<i32>(color)][static_cast<i32>(square)] != 0;
+		}
+
+		[[nodiscard]] inline auto attackedSquares(Color color) const
+		{
+			const auto &colorCounts = counts[static_cast<i32>(color)];
+
+			u64 squares{};
+
+			for (i32 i = 0; i < 64; ++i)
+			{
+				squares |= static_cast<u64>(colorCounts[i] != 0) << i;
+			}
+
+			return Bitboard{squares};
+		}
+
+		[[nodiscard]] inline auto operator==(const AttackMap &other) const -> bool = default;
+	};
+#endif
+
+	// Counts of the keys in a position's key history, bucketed by their low
+	// bits. An empty bucket means the key is not in the history at all, so
+	// isDrawn() can rule out a repetition without scanning it
+	struct KeyFilter
+	{
+		static constexpr usize Size = 1024;
+
+		std::array<u16, Size> counts{};
+
+		inline auto add(u64 key)
+		{
+			++counts[key % Size];
+		}
+
+		inline auto remove(u64 key)
+		{
+			assert(counts[key % Size] > 0);
+			--counts[key % Size];
+		}
+
+		inline auto clear()
+		{
+			counts.fill(0);
+		}
+
+		[[nodiscard]] inline auto mayContain(u64 key) const
+		{
+			return counts[key % Size] != 0;
+		}
+	};
+
 	struct BoardState
 	{
 		PositionBoards boards{};
@@ -107,14 +206,49 @@ namespace oranj
 
 		Bitboard checkers{};
 		Bitboard pinned{};
-		Bitboard threats{};
+
+		// Squares attacked by the side not to move. Only computed on
+		// first use, since many nodes are cut off before anything needs
+		// them - read through Position::threats() or threatsOf()
+		mutable Bitboard threats{};
 
 		u16 halfmove{};
 
 		KingPair kings{};
+
+		mutable bool threatsValid{};
+
+#if OJ_INCREMENTAL_ATTACKS
+		AttackMap attacks{};
+#endif
 	};
 
+#if OJ_INCREMENTAL_ATTACKS
+	static_assert(sizeof(BoardState) == 328);
+#else
 	static_assert(sizeof(BoardState) == 200);
+#endif
+
+#if OJ_UNDO_LOG
+	// Everything popMove() cannot rederive from the move itself. Keys are
+	// restored by xoring the moved pieces back out, and the boards by
+	// replaying the move in reverse
+	struct UndoRecord
+	{
+		Bitboard checkers{};
+		Bitboard pinned{};
+		Bitboard threats{};
+
+		u16 halfmove{};
+
+		Move move{NullMove};
+		Piece captured{Piece::None};
+
+		bool threatsValid{};
+	};
+
+	static_assert(sizeof(UndoRecord) == 32);
+#endif
 
 	[[nodiscard]] inline auto squareToString(Square square)
 	{
@@ -151,7 +285,7 @@ namespace oranj
 		Position(Position &&) = default;
 
 		auto resetToStarting() -> void;
-		auto resetFromFen(const std::string &fen) -> bool;
+		auto resetFromFen(std::string_view fen) -> bool;
 		auto resetFromFrcIndex(u32 n) -> bool;
 		auto resetFromDfrcIndex(u32 n) -> bool;
 
@@ -297,6 +431,9 @@ namespace oranj
 			return attackers;
 		}
 
+		// ThreatShortcut uses the state's threats, or its attack map with
+		// OJ_INCREMENTAL_ATTACKS. Both are only valid for states maintained
+		// by a Position, so pass false for a state still being built
 		template <bool ThreatShortcut = true>
 		[[nodiscard]] static inline auto isAttacked(const BoardState &state,
 			Color toMove, Square square, Color attacker)
@@ -307,8 +444,15 @@ namespace oranj
 
 			if constexpr (ThreatShortcut)
 			{
+#if OJ_INCREMENTAL_ATTACKS
+				return state.attacks.attacked(attacker, square);
+#else
 				if (attacker != toMove)
-					return state.threats[square];
+				{
+					const auto threats = threatsOf(state, toMove);
+					return threats[square];
+				}
+#endif
 			}
 
 			const auto &bbs = state.boards.bbs();
@@ -356,7 +500,7 @@ namespace oranj
 			assert(attacker != Color::None);
 
 			if (attacker == opponent())
-				return !(squares & currState().threats).empty();
+				return !(squares & threats()).empty();
 
 			while (squares)
 			{
@@ -404,7 +548,18 @@ namespace oranj
 
 		[[nodiscard]] inline auto checkers() const { return currState().checkers; }
 		[[nodiscard]] inline auto pinned() const { return currState().pinned; }
-		[[nodiscard]] inline auto threats() const { return currState().threats; }
+		[[nodiscard]] inline auto threats() const -> Bitboard { return threatsOf(currState(), toMove()); }
+
+		[[nodiscard]] static inline auto threatsOf(const BoardState &state, Color toMove) -> Bitboard
+		{
+			if (!state.threatsValid)
+			{
+				state.threats = calcThreats(state, toMove);
+				state.threatsValid = true;
+			}
+
+			return state.threats;
+		}
 
 		[[nodiscard]] auto hasCycle(i32 ply) const -> bool;
 		[[nodiscard]] auto isDrawn(bool threefold) const -> bool;
@@ -443,6 +598,8 @@ namespace oranj
 		}
 
 		[[nodiscard]] auto toFen() const -> std::string;
+		// appends the fen to dst, allocating only if dst needs to grow
+		auto writeFen(std::string &dst) const -> void;
 
 		[[nodiscard]] inline auto operator==(const Position &other) const
 		{
@@ -461,7 +618,7 @@ namespace oranj
 				&& currState().kings == other.m_states.back().kings
 				&& currState().checkers == other.m_states.back().checkers
 				&& currState().pinned == other.m_states.back().pinned
-				&& currState().threats == other.m_states.back().threats
+				&& threats() == other.threats()
 				&& currState().keys == other.m_states.back().keys;
 		}
 
@@ -489,11 +646,33 @@ namespace oranj
 		auto operator=(Position &&) -> Position & = default;
 
 		[[nodiscard]] static auto starting() -> Position;
-		[[nodiscard]] static auto fromFen(const std::string &fen) -> std::optional<Position>;
+		[[nodiscard]] static auto fromFen(std::string_view fen) -> std::optional<Position>;
 		[[nodiscard]] static auto fromFrcIndex(u32 n) -> std::optional<Position>;
 		[[nodiscard]] static auto fromDfrcIndex(u32 n) -> std::optional<Position>;
 
 	private:
+		inline auto clearKeyHistory() -> void
+		{
+			m_keys.clear();
+			m_keyFilter.clear();
+		}
+
+		inline auto clearUndoLog() -> void
+		{
+#if OJ_UNDO_LOG
+			m_undo.clear();
+#endif
+		}
+
+#if OJ_INCREMENTAL_ATTACKS
+		// Removes the attacks of every piece that a change to the given squares
+		// could affect - pieces on those squares, and rooks that see them -
+		// and returns where those pieces were. dropAttacks() adds back the
+		// attacks of whatever is on those squares after the change
+		auto liftAttacks(Bitboard changed) -> Bitboard;
+		auto dropAttacks(Bitboard lifted, Bitboard changed) -> void;
+#endif
+
 		template <bool UpdateKeys = true>
 		auto setPiece(Piece piece, Square square) -> void;
 		template <bool UpdateKeys = true>
@@ -544,12 +723,13 @@ namespace oranj
 			return pinned;
 		}
 
-		[[nodiscard]] inline auto calcThreats() const
+		[[nodiscard]] static inline auto calcThreats(const BoardState &state, Color us) -> Bitboard
 		{
-			const auto us = toMove();
 			const auto them = oppColor(us);
 
-			const auto &state = currState();
+#if OJ_INCREMENTAL_ATTACKS
+			return state.attacks.attackedSquares(them);
+#else
 			const auto &bbs = state.boards.bbs();
 
 			Bitboard threats{};
@@ -592,14 +772,21 @@ namespace oranj
 			threats |= attacks::getKingAttacks(state.kings.color(them));
 
 			return threats;
+#endif
 		}
 
 		bool m_blackToMove{};
 
 		u32 m_fullmove{1};
 
+		// only ever holds the current state when OJ_UNDO_LOG is set
 		std::vector<BoardState> m_states{};
 		std::vector<u64> m_keys{};
+		KeyFilter m_keyFilter{};
+
+#if OJ_UNDO_LOG
+		std::vector<UndoRecord> m_undo{};
+#endif
 	};
 
 	template <bool UpdateNnue>
@@ -0,0 +1,299 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "replay.h"
+
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+#include "search.h"
+#include "position/position.h"
+#include "limit/time.h"
+#include "util/parse.h"
+#include "util/split.h"
+#include "util/timer.h"
+#include "uci.h"
+
+namespace oranj::replay
+{
+	namespace
+	{
+		struct TimeControl
+		{
+			f64 base;
+			f64 increment;
+		};
+
+		[[nodiscard]] auto parseTimeControl(const std::string &tc) -> std::optional<TimeControl>
+		{
+			const auto plus = tc.find('+');
+
+			const auto base = util::tryParseF64(tc.substr(0, plus));
+			const auto increment = plus == std::string::npos
+				? std::optional{0.0} : util::tryParseF64(tc.substr(plus + 1));
+
+			if (!base || !increment || *base <= 0.0 || *increment < 0.0)
+				return {};
+
+			return TimeControl{*base, *increment};
+		}
+
+		struct Game
+		{
+			Position start{};
+			std::vector<Move> moves{};
+		};
+
+		[[nodiscard]] auto parseGame(const std::string &line, u32 lineNumber) -> std::optional<Game>
+		{
+			const auto tokens = split::split(line, ' ');
+
+			usize next = 0;
+
+			if (next < tokens.size() && tokens[next] == "position")
+				++next;
+
+			if (next >= tokens.size())
+				return {};
+
+			Game game{};
+
+			if (tokens[next] == "startpos")
+			{
+				game.start.resetToStarting();
+				++next;
+			}
+			else if (tokens[next] == "fen")
+			{
+				std::string fen{};
+
+				for (++next; next < tokens.size() && tokens[next] != "moves"; ++next)
+				{
+					fen += tokens[next];
+					fen += ' ';
+				}
+
+				if (!game.start.resetFromFen(fen))
+				{
+					std::cerr << "invalid fen on line " << lineNumber << std::endl;
+					return {};
+				}
+			}
+			else
+			{
+				std::cerr << "invalid game on line " << lineNumber << std::endl;
+				return {};
+			}
+
+			if (next < tokens.size() && tokens[next++] != "moves")
+			{
+				std::cerr << "expected moves on line " << lineNumber << std::endl;
+				return {};
+			}
+
+			auto pos = game.start;
+
+			for (; next < tokens.size(); ++next)
+			{
+				const auto move = pos.moveFromUci(tokens[next]);
+
+				if (!move || !pos.isPseudolegal(move) || !pos.isLegal(move))
+				{
+					std::cerr << "illegal move " << tokens[next] << " on line " << lineNumber
+						<< ", truncating game" << std::endl;
+					break;
+				}
+
+				game.moves.push_back(move);
+				pos.applyMoveUnchecked<false>(move, nullptr);
+			}
+
+			return game;
+		}
+
+		struct Totals
+		{
+			usize games{};
+			usize searches{};
+
+			usize nodes{};
+			f64 time{};
+
+			u64 depth{};
+
+			f64 allotted{};
+			usize hashfull{};
+
+			usize flags{};
+		};
+	}
+
+	auto run(const std::string &path, const std::string &tc, usize ttSizeMib) -> i32
+	{
+		const auto timeControl = parseTimeControl(tc);
+
+		if (!timeControl)
+		{
+			std::cerr << "invalid time control " << tc << " (expected <base>+<increment> in seconds)" << std::endl;
+			return 1;
+		}
+
+		std::ifstream stream{path};
+
+		if (!stream)
+		{
+			std::cerr << "failed to open " << path << std::endl;
+			return 1;
+		}
+
+		std::vector<Game> games{};
+
+		u32 lineNumber = 0;
+		for (std::string line{}; std::getline(stream, line);)
+		{
+			++lineNumber;
+
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			if (auto game = parseGame(line, lineNumber))
+				games.push_back(std::move(*game));
+		}
+
+		if (games.empty())
+		{
+			std::cerr << "no games in " << path << std::endl;
+			return 1;
+		}
+
+		std::cout << "replaying " << games.size() << " games at " << timeControl->base
+			<< "+" << timeControl->increment << std::endl;
+
+		search::Searcher searcher{ttSizeMib};
+		searcher.ensureReady();
+
+		// persists between moves like the search threads' data does
+		auto thread = std::make_unique<search::ThreadData>();
+
+		const auto overhead = static_cast<f64>(limit::DefaultMoveOverhead) / 1000.0;
+
+		Totals totals{};
+
+		for (usize gameIdx = 0; gameIdx < games.size(); ++gameIdx)
+		{
+			const auto &game = games[gameIdx];
+
+			searcher.newGame();
+
+			thread->history.clear();
+			thread->correctionHistory.clear();
+
+			std::array<f64, 2> clocks{timeControl->base, timeControl->base};
+
+			auto pos = game.start;
+
+			// the final position is searched too, if it has any legal moves
+			for (usize ply = 0; ply <= game.moves.size(); ++ply)
+			{
+				const auto stm = static_cast<i32>(pos.toMove());
+
+				const auto start = util::Instant::now();
+
+				auto limiter = std::make_unique<limit::TimeManager>(start,
+					clocks[stm], timeControl->increment, 0, overhead);
+				const auto &timeManager = *limiter;
+
+				thread->pos = pos;
+
+				search::BenchData data{};
+				searcher.runReplaySearch(data, *thread, std::move(limiter));
+
+				const auto used = start.elapsed();
+
+				// no legal moves
+				if (data.search.nodes == 0)
+					break;
+
+				clocks[stm] -= used;
+
+				const bool flagged = clocks[stm] <= 0.0;
+				if (flagged)
+				{
+					++totals.flags;
+					clocks[stm] = 0.001;
+				}
+
+				clocks[stm] += timeControl->increment;
+
+				const auto nodes = data.search.loadNodes();
+				const auto hashfull = searcher.hashfull();
+
+				std::cout << "game " << (gameIdx + 1) << " ply " << ply
+					<< " depth " << thread->depthCompleted
+					<< " seldepth " << data.search.loadSeldepth()
+					<< " nodes " << nodes
+					<< " nps " << static_cast<usize>(static_cast<f64>(nodes) / used)
+					<< " time " << static_cast<usize>(used * 1000.0)
+					<< " soft " << static_cast<usize>(timeManager.softTime() * 1000.0)
+					<< " hard " << static_cast<usize>(timeManager.maxTime() * 1000.0)
+					<< " hashfull " << hashfull
+					<< " bestmove " << uci::moveToString(thread->lastPv.moves[0]);
+
+				if (flagged)
+					std::cout << " flagged";
+
+				std::cout << std::endl;
+
+				++totals.searches;
+				totals.nodes += nodes;
+				totals.time += used;
+				totals.depth += thread->depthCompleted;
+				totals.allotted += timeManager.softTime();
+				totals.hashfull += hashfull;
+
+				if (ply < game.moves.size())
+					pos.applyMoveUnchecked<false>(game.moves[ply], nullptr);
+			}
+
+			++totals.games;
+		}
+
+		if (totals.searches == 0)
+			return 0;
+
+		const auto searches = static_cast<f64>(totals.searches);
+
+		std::cout << "\n" << totals.games << " games, " << totals.searches << " searches" << std::endl;
+		std::cout << "average depth: " << static_cast<f64>(totals.depth) / searches << std::endl;
+		std::cout << "average time used/soft limit: " << (totals.time / searches * 1000.0)
+			<< "/" << (totals.allotted / searches * 1000.0) << " ms" << std::endl;
+		std::cout << "average hashfull: " << static_cast<f64>(totals.hashfull) / searches << std::endl;
+		std::cout << "flags: " << totals.flags << std::endl;
+		std::cout << totals.nodes << " nodes " << static_cast<usize>(static_cast<f64>(totals.nodes) / totals.time)
+			<< " nps" << std::endl;
+
+		return 0;
+	}
+}
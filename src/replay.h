@@ -0,0 +1,34 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+
+#include <string>
+
+#include "ttable.h"
+
+namespace oranj::replay
+{
+	// replays recorded games, searching every position under simulated clocks
+	// file format: one game per line, "startpos [moves ...]" or
+	// "fen <fen> [moves ...]", optionally prefixed with "position"
+	// tc format: <base>+<increment>, in seconds
+	auto run(const std::string &path, const std::string &tc, usize ttSizeMib = DefaultTtSizeMib) -> i32;
+}
@@ -25,6 +25,7 @@
 #include "limit/trivial.h"
 #include "opts.h"
 #include "see.h"
+#include "util/multi_array.h"
 
 namespace oranj::search
 {
@@ -84,6 +85,10 @@ namespace oranj::search
 		}};
 	}
 
+	Searcher::Searcher(usize ttSizeMib, NoSearchThreadsTag)
+		: m_ttable{ttSizeMib},
+		  m_startTime{Instant::now()} {}
+
 	auto Searcher::newGame() -> void
 	{
 		// Finalisation (init) clears the TT, so don't clear it twice
@@ -92,9 +97,10 @@ namespace oranj::search
 
 		for (auto &thread : m_threads)
 		{
-			thread.history.clear();
-			thread.correctionHistory.clear();
+			thread.resetForNewGame();
 		}
+
+		m_carriedPv.length = 0;
 	}
 
 	auto Searcher::ensureReady() -> void
@@ -103,7 +109,7 @@ namespace oranj::search
 	}
 
 	auto Searcher::startSearch(const Position &pos, Instant startTime, i32 maxDepth,
-		std::span<Move> moves, std::unique_ptr<limit::ISearchLimiter> limiter, bool infinite) -> void
+		std::span<Move> moves, std::unique_ptr<limit::ISearchLimiter> limiter, bool infinite, bool ponder) -> void
 	{
 		if (!m_limiter && !limiter)
 		{
@@ -156,6 +162,8 @@ namespace oranj::search
 		if (limiter)
 			m_limiter = std::move(limiter);
 
+		seedCarriedPv(pos);
+
 		const auto contempt = g_opts.contempt;
 
 		m_contempt[static_cast<i32>(pos.  toMove())] =  contempt;
@@ -172,6 +180,7 @@ namespace oranj::search
 
 		m_startTime = startTime;
 
+		m_pondering.store(ponder, std::memory_order::release);
 		m_stop.store(false, std::memory_order::seq_cst);
 		m_runningThreads.store(static_cast<i32>(m_threads.size()));
 
@@ -195,6 +204,68 @@ namespace oranj::search
 		}
 	}
 
+	auto Searcher::carryPv(const Position &root, const PvList &pv) -> void
+	{
+		m_carriedPv.length = 0;
+
+		// nothing left to carry once our move and the reply are played
+		if (pv.length <= 2)
+			return;
+
+		Position pos{};
+		pos.copyStateFrom(root);
+
+		pos.applyMoveUnchecked<false>(pv.moves[0], nullptr);
+		pos.applyMoveUnchecked<false>(pv.moves[1], nullptr);
+
+		m_carriedPvKey = pos.key();
+
+		std::copy(pv.moves.begin() + 2, pv.moves.begin() + pv.length, m_carriedPv.moves.begin());
+		m_carriedPv.length = pv.length - 2;
+	}
+
+	auto Searcher::seedCarriedPv(const Position &root) -> void
+	{
+		if (m_carriedPv.length == 0 || root.key() != m_carriedPvKey)
+			return;
+
+		Position pos{};
+		pos.copyStateFrom(root);
+
+		// make sure the rest of the old pv is tried first in the early
+		// iterations, in case it was overwritten in the tt since. existing
+		// entries are left alone apart from gaining the move
+		for (u32 i = 0; i < m_carriedPv.length; ++i)
+		{
+			const auto move = m_carriedPv.moves[i];
+
+			if (!pos.isPseudolegal(move) || !pos.isLegal(move))
+				break;
+
+			ProbedTTableEntry ttEntry{};
+
+			if (!m_ttable.probe(ttEntry, pos.key(), 0))
+				m_ttable.put(pos.key(), ScoreNone, ScoreNone, move, 0, 0, TtFlag::None, true);
+			else if (!ttEntry.move)
+				m_ttable.put(pos.key(), ttEntry.score, ttEntry.staticEval,
+					move, ttEntry.depth, 0, ttEntry.flag, ttEntry.wasPv);
+
+			pos.applyMoveUnchecked<false>(move, nullptr);
+		}
+
+		m_carriedPv.length = 0;
+	}
+
+	auto Searcher::ponderhit() -> void
+	{
+		// safe, always runs from uci thread, so the limiter cannot be replaced under us
+		if (!m_pondering.load(std::memory_order::acquire))
+			return;
+
+		m_limiter->ponderhit();
+		m_pondering.store(false, std::memory_order::release);
+	}
+
 	auto Searcher::runDatagenSearch(ThreadData &thread) -> std::pair<Score, Score>
 	{
 		if (initRootMoves(thread.pos) == RootStatus::NoLegalMoves)
@@ -243,6 +314,44 @@ namespace oranj::search
 		data.time = start.elapsed();
 	}
 
+	auto Searcher::runReplaySearch(BenchData &data, ThreadData &thread,
+		std::unique_ptr<limit::ISearchLimiter> limiter) -> void
+	{
+		m_limiter = std::move(limiter);
+		m_infinite = false;
+
+		const auto contempt = g_opts.contempt;
+
+		m_contempt[static_cast<i32>(thread.pos.  toMove())] =  contempt;
+		m_contempt[static_cast<i32>(thread.pos.opponent())] = -contempt;
+
+		thread.maxDepth = MaxDepth;
+		thread.search = SearchData{};
+
+		thread.nnueState.reset(thread.pos.bbs(), thread.pos.kings());
+
+		if (initRootMoves(thread.pos) == RootStatus::NoLegalMoves)
+			return;
+
+		seedCarriedPv(thread.pos);
+		thread.ageHistory();
+
+		// aged before rather than after searching, so hashfull
+		// can still be read for this search once it returns
+		m_ttable.age();
+
+		m_stop.store(false, std::memory_order::seq_cst);
+
+		const auto start = Instant::now();
+
+		searchRoot(thread, false);
+
+		carryPv(thread.pos, thread.lastPv);
+
+		data.search = thread.search;
+		data.time = start.elapsed();
+	}
+
 	auto Searcher::setThreads(u32 threadCount) -> void
 	{
 		if (threadCount == m_threads.size())
@@ -283,6 +392,10 @@ namespace oranj::search
 
 	auto Searcher::stopThreads() -> void
 	{
+		// nobody would arrive at the barriers
+		if (m_threads.empty())
+			return;
+
 		m_quit.store(true, std::memory_order::release);
 
 		m_resetBarrier.arriveAndWait();
@@ -325,6 +438,9 @@ namespace oranj::search
 		searchData.nodes = 0;
 		thread.stack[0].killers.clear();
 
+		if (actualSearch)
+			thread.ageHistory();
+
 		i32 depthCompleted{};
 
 		for (i32 depth = 1;; ++depth)
@@ -393,24 +509,25 @@ namespace oranj::search
 
 			if (depth >= thread.maxDepth)
 			{
-				if (mainThread && m_infinite)
+				if (mainThread && mustWait())
 					report(thread, pv, searchData.rootDepth, elapsed(), score);
 				break;
 			}
 
-			if (mainThread)
-			{
+			if (thread.isMainThread())
 				m_limiter->update(thread.search, score, pv.moves[0], thread.search.loadNodes());
 
-				if (checkSoftTimeout(thread.search, true))
-					break;
+			if (checkSoftTimeout(thread.search, thread.isMainThread()))
+				break;
 
+			if (mainThread)
 				report(thread, pv, searchData.rootDepth, elapsed(), score);
-			}
-			else if (checkSoftTimeout(thread.search, thread.isMainThread()))
-				break;
 		}
 
+		thread.depthCompleted = depthCompleted;
+		thread.lastScore = score;
+		thread.lastPv = pv;
+
 		const auto waitForThreads = [&]
 		{
 			--m_runningThreads;
@@ -423,14 +540,12 @@ namespace oranj::search
 		{
 			auto time = elapsed();
 
-			if (m_infinite)
+			// don't print bestmove until stopped when go infinite'ing, or until
+			// stopped or ponderhit when pondering. this makes handling reports
+			// a bit messy, unfortunately
+			while (!hasStopped() && mustWait())
 			{
-				// don't print bestmove until stopped when go infinite'ing
-				// this makes handling reports a bit messy, unfortunately
-				while (!hasStopped())
-				{
-					std::this_thread::yield();
-				}
+				std::this_thread::yield();
 			}
 
 			const std::unique_lock lock{m_searchMutex};
@@ -438,10 +553,15 @@ namespace oranj::search
 			m_stop.store(true, std::memory_order::seq_cst);
 			waitForThreads();
 
+			m_pondering.store(false, std::memory_order::release);
+
 			if (!m_infinite)
 				time = elapsed();
 
-			finalReport(thread, pv, depthCompleted, time, score);
+			const auto &bestThread = selectBestThread(thread);
+			finalReport(thread, bestThread.lastPv, bestThread.depthCompleted, time, bestThread.lastScore);
+
+			carryPv(thread.pos, bestThread.lastPv);
 
 			m_ttable.age();
 
@@ -452,6 +572,72 @@ namespace oranj::search
 		return score;
 	}
 
+	auto Searcher::selectBestThread(const ThreadData &mainThread) const -> const ThreadData &
+	{
+		if (m_threads.size() == 1)
+			return mainThread;
+
+		const auto *best = &mainThread;
+		auto minScore = ScoreInf;
+
+		for (const auto &thread : m_threads)
+		{
+			if (thread.depthCompleted == 0)
+				continue;
+
+			if (best->depthCompleted == 0)
+				best = &thread;
+
+			minScore = std::min(minScore, thread.lastScore);
+		}
+
+		// nothing completed an iteration, fall back to whatever the main thread has
+		if (best->depthCompleted == 0)
+			return mainThread;
+
+		// each thread votes for its root move, weighted by its depth
+		// and by how far its score is above the worst thread's
+		util::MultiArray<i64, 64, 64> votes{};
+
+		const auto vote = [&](const ThreadData &thread) -> i64 &
+		{
+			const auto move = thread.lastPv.moves[0];
+			return votes[move.srcIdx()][move.dstIdx()];
+		};
+
+		for (const auto &thread : m_threads)
+		{
+			if (thread.depthCompleted == 0)
+				continue;
+
+			vote(thread) += static_cast<i64>(thread.lastScore - minScore + bestThreadVoteOffset())
+				* thread.depthCompleted;
+		}
+
+		for (const auto &thread : m_threads)
+		{
+			if (thread.depthCompleted == 0 || &thread == best)
+				continue;
+
+			const auto bestScore = best->lastScore;
+
+			// proven results override votes - take the shortest mate,
+			// or the longest one if every thread is getting mated
+			if (std::abs(bestScore) >= ScoreWin)
+			{
+				if (thread.lastScore > bestScore)
+					best = &thread;
+			}
+			else if (thread.lastScore >= ScoreWin)
+				best = &thread;
+			else if (vote(thread) > vote(*best)
+				|| (vote(thread) == vote(*best) && thread.depthCompleted > best->depthCompleted))
+				best = &thread;
+		}
+
+		return *best;
+	}
+
 	template <bool PvNode, bool RootNode>
 	auto Searcher::search(ThreadData &thread, PvList &pv, i32 depth,
 		i32 ply, u32 moveStackIdx, Score alpha, Score beta, bool cutnode) -> Score
@@ -1139,8 +1325,10 @@ namespace oranj::search
 			}
 		}
 
-		// stalemate not handled
-		if (inCheck && legalMoves == 0)
+		// out of check, qsearch only searches noisy moves, so no searched moves does
+		// not mean no legal moves. Stalemate is a loss in shatranj, like checkmate
+		if (legalMoves == 0
+			&& (inCheck || !hasLegalMove(pos)))
 			return -ScoreMate + ply;
 
 		m_ttable.put(pos.key(), bestScore, rawStaticEval, bestMove, 0, ply, ttFlag, ttpv);
@@ -1229,6 +1417,38 @@ namespace oranj::search
 		const PvList &pv, i32 depthCompleted, f64 time, Score score) -> void
 	{
 		report(mainThread, pv, depthCompleted, time, score);
-		std::cout << "bestmove " << uci::moveToString(pv.moves[0]) << std::endl;
+
+		std::cout << "bestmove " << uci::moveToString(pv.moves[0]);
+
+		if (const auto ponderMove = findPonderMove(mainThread.pos, pv))
+			std::cout << " ponder " << uci::moveToString(ponderMove);
+
+		std::cout << std::endl;
+	}
+
+	auto Searcher::findPonderMove(const Position &root, const PvList &pv) const -> Move
+	{
+		if (pv.length == 0)
+			return NullMove;
+
+		if (pv.length > 1)
+			return pv.moves[1];
+
+		// pv was cut short (tt cutoff, or only one iteration completed)
+		// so try to recover the expected reply from the tt instead
+		Position pos{};
+		pos.copyStateFrom(root);
+
+		pos.applyMoveUnchecked<false>(pv.moves[0], nullptr);
+
+		ProbedTTableEntry ttEntry{};
+
+		if (m_ttable.probe(ttEntry, pos.key(), 0)
+			&& ttEntry.move
+			&& pos.isPseudolegal(ttEntry.move)
+			&& pos.isLegal(ttEntry.move))
+			return ttEntry.move;
+
+		return NullMove;
 	}
 }
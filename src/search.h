@@ -43,6 +43,7 @@
 #include "util/barrier.h"
 #include "history.h"
 #include "correction.h"
+#include "tunable.h"
 
 namespace oranj::search
 {
@@ -113,6 +114,18 @@ namespace oranj::search
 			contMoves.resize(MaxDepth + 4);
 		}
 
+		// clears everything a previous game could have left behind. search
+		// state (ThreadData::search) is reset separately before each search
+		inline auto resetForNewGame() -> void
+		{
+			history.clear();
+			correctionHistory.clear();
+
+			// can be left over from a search stopped mid-verification
+			minNmpPly = 0;
+			std::ranges::fill(stack, SearchStackEntry{});
+		}
+
 		u32 id{};
 		std::thread thread{};
 
@@ -127,6 +140,12 @@ namespace oranj::search
 
 		PvList rootPv{};
 
+		// result of the last completed iteration, written before
+		// the search end barrier so the main thread can vote on it
+		i32 depthCompleted{};
+		Score lastScore{};
+		PvList lastPv{};
+
 		eval::NnueState nnueState{};
 
 		std::vector<SearchStackEntry> stack{};
@@ -168,12 +187,25 @@ namespace oranj::search
 		{
 			contMoves[ply] = { Piece::None, Square::None };
 		}
+
+		// decays history carried over from previous moves of the same game
+		inline auto ageHistory()
+		{
+			history.age(tunable::historyAgeScale());
+			correctionHistory.age(tunable::corrhistAgeScale());
+		}
 	};
 
+	// constructs a searcher without any search threads of its own, usable only
+	// through the calling-thread entry points (runDatagenSearch, runBench, runReplaySearch)
+	struct NoSearchThreadsTag {};
+	constexpr NoSearchThreadsTag NoSearchThreads{};
+
 	class Searcher
 	{
 	public:
 		explicit Searcher(usize ttSize = DefaultTtSizeMib);
+		Searcher(usize ttSize, NoSearchThreadsTag);
 
 		~Searcher()
 		{
@@ -190,14 +222,23 @@ namespace oranj::search
 		}
 
 		auto startSearch(const Position &pos, util::Instant startTime, i32 maxDepth,
-			std::span<Move> moves, std::unique_ptr<limit::ISearchLimiter> limiter, bool infinite) -> void;
+			std::span<Move> moves, std::unique_ptr<limit::ISearchLimiter> limiter, bool infinite, bool ponder) -> void;
 		auto stop() -> void;
 
+		// converts a ponder search into a normal one, keeping everything searched so far
+		auto ponderhit() -> void;
+
 		// -> [move, unnormalised, normalised]
 		auto runDatagenSearch(ThreadData &thread) -> std::pair<Score, Score>;
 
 		auto runBench(BenchData &data, const Position &pos, i32 depth) -> void;
 
+		// searches on the calling thread like runBench, but under a real limiter
+		// and with the tt, history and carried pv persisting between calls
+		// the way they would between moves of a game
+		auto runReplaySearch(BenchData &data, ThreadData &thread,
+			std::unique_ptr<limit::ISearchLimiter> limiter) -> void;
+
 		[[nodiscard]] inline auto searching() const
 		{
 			const std::unique_lock lock{m_searchMutex};
@@ -211,6 +252,11 @@ namespace oranj::search
 			m_ttable.resize(mib);
 		}
 
+		[[nodiscard]] inline auto hashfull() const
+		{
+			return m_ttable.full();
+		}
+
 		inline auto quit() -> void
 		{
 			m_quit.store(true, std::memory_order::release);
@@ -244,9 +290,15 @@ namespace oranj::search
 
 		std::unique_ptr<limit::ISearchLimiter> m_limiter{};
 		bool m_infinite{};
+		std::atomic_bool m_pondering{};
 
 		MoveList m_rootMoves{};
 
+		// the remainder of the last search's pv, if the game continues
+		// along it - key of the position after our move and the expected reply
+		u64 m_carriedPvKey{};
+		PvList m_carriedPv{};
+
 		Score m_minRootScore{};
 		Score m_maxRootScore{};
 
@@ -263,6 +315,9 @@ namespace oranj::search
 
 		auto stopThreads() -> void;
 
+		auto carryPv(const Position &root, const PvList &pv) -> void;
+		auto seedCarriedPv(const Position &root) -> void;
+
 		auto run(ThreadData &thread) -> void;
 
 		[[nodiscard]] inline auto hasStopped() const
@@ -275,7 +330,10 @@ namespace oranj::search
 			if (hasStopped())
 				return true;
 
-			if (mainThread && m_limiter->stop(data, allowSoft))
+			// limits only apply once the opponent has played the expected move
+			if (mainThread
+				&& !m_pondering.load(std::memory_order::acquire)
+				&& m_limiter->stop(data, allowSoft))
 			{
 				m_stop.store(1, std::memory_order::relaxed);
 				return true;
@@ -299,6 +357,12 @@ namespace oranj::search
 			return m_startTime.elapsed();
 		}
 
+		// infinite and ponder searches must not print bestmove until told to
+		[[nodiscard]] inline auto mustWait() const
+		{
+			return m_infinite || m_pondering.load(std::memory_order::acquire);
+		}
+
 		[[nodiscard]] inline auto isLegalRootMove(Move move) const
 		{
 			return std::ranges::find(m_rootMoves, move) != m_rootMoves.end();
@@ -306,6 +370,9 @@ namespace oranj::search
 
 		auto searchRoot(ThreadData &thread, bool actualSearch) -> Score;
 
+		// must only be called after the search end barrier
+		[[nodiscard]] auto selectBestThread(const ThreadData &mainThread) const -> const ThreadData &;
+
 		template <bool PvNode = false, bool RootNode = false>
 		auto search(ThreadData &thread, PvList &pv, i32 depth, i32 ply,
 			u32 moveStackIdx, Score alpha, Score beta, bool cutnode) -> Score;
@@ -321,5 +388,7 @@ namespace oranj::search
 			f64 time, Score score, Score alpha = -ScoreInf, Score beta = ScoreInf) -> void;
 		auto finalReport(const ThreadData &mainThread, const PvList &pv,
 			i32 depthCompleted, f64 time, Score score) -> void;
+
+		[[nodiscard]] auto findPonderMove(const Position &root, const PvList &pv) const -> Move;
 	};
 }
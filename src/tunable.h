@@ -131,6 +131,8 @@ namespace oranj::tunable
 	OJ_TUNABLE_PARAM(initialAspWindow, 16, 4, 50, 4)
 	OJ_TUNABLE_PARAM(aspWideningFactor, 17, 1, 24, 1)
 
+	OJ_TUNABLE_PARAM(bestThreadVoteOffset, 10, 1, 50, 3)
+
 	OJ_TUNABLE_PARAM(goodNoisySeeOffset, 15, -384, 384, 40)
 
 	OJ_TUNABLE_PARAM(rfpMargin, 71, 25, 150, 5)
@@ -191,6 +193,9 @@ namespace oranj::tunable
 	OJ_TUNABLE_PARAM(historyPenaltyDepthScale, 343, 128, 512, 32)
 	OJ_TUNABLE_PARAM(historyPenaltyOffset, 161, 128, 768, 64)
 
+	OJ_TUNABLE_PARAM(historyAgeScale, 768, 0, 1024, 64)
+	OJ_TUNABLE_PARAM(corrhistAgeScale, 896, 0, 1024, 64)
+
 	OJ_TUNABLE_PARAM(qsearchFpMargin, 135, 50, 400, 17)
 	OJ_TUNABLE_PARAM(qsearchSeeThreshold, -97, -2000, 200, 100)
 
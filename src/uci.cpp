@@ -99,6 +99,7 @@ namespace oranj
 			auto handlePosition(const std::vector<std::string> &tokens) -> void;
 			auto handleGo(const std::vector<std::string> &tokens, Instant startTime) -> void;
 			auto handleStop() -> void;
+			auto handlePonderhit() -> void;
 			auto handleSetoption(const std::vector<std::string> &tokens) -> void;
 			// V ======= NONSTANDARD ======= V
 			auto handleD() -> void;
@@ -151,6 +152,8 @@ namespace oranj
 					handleGo(tokens, startTime);
 				else if (command == "stop")
 					handleStop();
+				else if (command == "ponderhit")
+					handlePonderhit();
 				else if (command == "setoption")
 					handleSetoption(tokens);
 				// V ======= NONSTANDARD ======= V
@@ -198,6 +201,7 @@ namespace oranj
 			std::cout << "option name Clear Hash type button\n";
 			std::cout << "option name Threads type spin default " << opts::DefaultThreadCount
 				<< " min " << opts::ThreadCountRange.min() << " max " << opts::ThreadCountRange.max() << '\n';
+			std::cout << "option name Ponder type check default " << defaultOpts.ponder << '\n';
 			std::cout << "option name Contempt type spin default " << opts::DefaultNormalizedContempt
 				<< " min " << ContemptRange.min() << " max " << ContemptRange.max() << '\n';
 			std::cout << "option name UCI_Chess960 type check default " << defaultOpts.chess960 << '\n';
@@ -211,6 +215,7 @@ namespace oranj
 				<< " min " << limit::SoftNodeHardLimitMultiplierRange.min()
 				<< " max " << limit::SoftNodeHardLimitMultiplierRange.max() << '\n';
 			std::cout << "option name EnableWeirdTCs type check default " << defaultOpts.enableWeirdTcs << std::endl;
+			std::cout << "option name Deterministic type check default " << defaultOpts.deterministic << std::endl;
 			std::cout << "option name EvalFile type string default <internal>" << std::endl;
 
 #if OJ_EXTERNAL_TUNE
@@ -316,7 +321,9 @@ namespace oranj
 				MoveList movesToSearch{};
 
 				bool infinite = false;
+				bool ponder = false;
 				bool tournamentTime = false;
+				bool moveTime = false;
 
 				i64 timeRemaining{};
 				i64 increment{};
@@ -337,6 +344,12 @@ namespace oranj
 						continue;
 					}
 
+					if (tokens[i] == "ponder")
+					{
+						ponder = true;
+						continue;
+					}
+
 					if (tokens[i] == "nodes" && ++i < tokens.size())
 					{
 						usize nodes{};
@@ -351,6 +364,8 @@ namespace oranj
 							std::cerr << "invalid time " << tokens[i] << std::endl;
 						else
 						{
+							moveTime = true;
+
 							time = std::max<i64>(time, 1);
 							limiter->addLimiter<limit::MoveTimeLimiter>(time, m_moveOverhead);
 						}
@@ -476,6 +491,21 @@ namespace oranj
 					}
 				}
 
+				if (g_opts.deterministic)
+				{
+					if (g_opts.threads > 1)
+						std::cout << "info string Warning: searches are only"
+							" reproducible with Threads set to 1" << std::endl;
+
+					if (tournamentTime || moveTime)
+						std::cout << "info string Warning: time-limited searches are not"
+							" reproducible, use go nodes or go depth" << std::endl;
+
+					// every search starts from the same empty tt and histories,
+					// without anything carried over from previous searches
+					m_searcher.newGame();
+				}
+
 				if (tournamentTime && timeRemaining > 0)
 					limiter->addLimiter<limit::TimeManager>(startTime,
 						static_cast<f64>(timeRemaining) / 1000.0,
@@ -483,7 +513,7 @@ namespace oranj
 						toGo, static_cast<f64>(m_moveOverhead) / 1000.0);
 
 				m_searcher.startSearch(m_pos, startTime,
-					static_cast<i32>(depth), movesToSearch, std::move(limiter), infinite);
+					static_cast<i32>(depth), movesToSearch, std::move(limiter), infinite, ponder);
 			}
 		}
 
@@ -494,6 +524,13 @@ namespace oranj
 			else m_searcher.stop();
 		}
 
+		auto UciHandler::handlePonderhit() -> void
+		{
+			if (!m_searcher.searching())
+				std::cerr << "not searching" << std::endl;
+			else m_searcher.ponderhit();
+		}
+
 		//TODO refactor
 		auto UciHandler::handleSetoption(const std::vector<std::string> &tokens) -> void
 		{
@@ -569,6 +606,14 @@ namespace oranj
 						}
 					}
 				}
+				else if (nameStr == "ponder")
+				{
+					if (!valueEmpty)
+					{
+						if (const auto newPonder = util::tryParseBool(valueStr))
+							opts::mutableOpts().ponder = *newPonder;
+					}
+				}
 				else if (nameStr == "contempt")
 				{
 					if (!valueEmpty)
@@ -635,6 +680,14 @@ namespace oranj
 							opts::mutableOpts().enableWeirdTcs = *newEnableWeirdTcs;
 					}
 				}
+				else if (nameStr == "deterministic")
+				{
+					if (!valueEmpty)
+					{
+						if (const auto newDeterministic = util::tryParseBool(valueStr))
+							opts::mutableOpts().deterministic = *newDeterministic;
+					}
+				}
 				else if (nameStr == "evalfile")
 				{
 					if (m_searcher.searching())
@@ -753,36 +806,52 @@ namespace oranj
 			std::cout << std::endl;
 		}
 
-		auto UciHandler::handlePerft(const std::vector<std::string> &tokens) -> void
+		// perft/splitperft [depth] [threads] [hash MiB]
+		auto parsePerftArgs(const std::vector<std::string> &tokens, u32 &depth, u32 &threads, u32 &hashMib) -> bool
 		{
-			u32 depth = 6;
+			if (tokens.size() > 1 && !util::tryParseU32(depth, tokens[1]))
+			{
+				std::cerr << "invalid depth " << tokens[1] << std::endl;
+				return false;
+			}
 
-			if (tokens.size() > 1)
+			if (tokens.size() > 2 && (!util::tryParseU32(threads, tokens[2]) || threads == 0))
 			{
-				if (!util::tryParseU32(depth, tokens[1]))
-				{
-					std::cerr << "invalid depth " << tokens[1] << std::endl;
-					return;
-				}
+				std::cerr << "invalid thread count " << tokens[2] << std::endl;
+				return false;
+			}
+
+			if (tokens.size() > 3 && !util::tryParseU32(hashMib, tokens[3]))
+			{
+				std::cerr << "invalid hash size " << tokens[3] << std::endl;
+				return false;
 			}
 
-			perft(m_pos, static_cast<i32>(depth));
+			return true;
+		}
+
+		auto UciHandler::handlePerft(const std::vector<std::string> &tokens) -> void
+		{
+			u32 depth = 6;
+			u32 threads = g_opts.threads;
+			u32 hashMib = 0;
+
+			if (!parsePerftArgs(tokens, depth, threads, hashMib))
+				return;
+
+			perft(m_pos, static_cast<i32>(depth), threads, hashMib);
 		}
 
 		auto UciHandler::handleSplitperft(const std::vector<std::string> &tokens) -> void
 		{
 			u32 depth = 6;
+			u32 threads = g_opts.threads;
+			u32 hashMib = 0;
 
-			if (tokens.size() > 1)
-			{
-				if (!util::tryParseU32(depth, tokens[1]))
-				{
-					std::cerr << "invalid depth " << tokens[1] << std::endl;
-					return;
-				}
-			}
+			if (!parsePerftArgs(tokens, depth, threads, hashMib))
+				return;
 
-			splitPerft(m_pos, static_cast<i32>(depth));
+			splitPerft(m_pos, static_cast<i32>(depth), threads, hashMib);
 		}
 
 		auto UciHandler::handleBench(const std::vector<std::string> &tokens) -> void
@@ -0,0 +1,136 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mapped_file.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace oranj::util
+{
+	MappedFile::~MappedFile()
+	{
+#ifdef _WIN32
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file && m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+#else
+		if (m_data)
+			munmap(const_cast<char *>(m_data), m_size);
+#endif
+	}
+
+	auto MappedFile::open(const std::filesystem::path &path) -> std::unique_ptr<MappedFile>
+	{
+		std::unique_ptr<MappedFile> file{new MappedFile{}};
+
+#ifdef _WIN32
+		file->m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file->m_file == INVALID_HANDLE_VALUE)
+		{
+			std::cerr << "failed to open " << path << std::endl;
+			return nullptr;
+		}
+
+		LARGE_INTEGER size{};
+
+		if (!GetFileSizeEx(file->m_file, &size))
+		{
+			std::cerr << "failed to get size of " << path << std::endl;
+			return nullptr;
+		}
+
+		file->m_size = static_cast<usize>(size.QuadPart);
+
+		// empty files cannot be mapped
+		if (file->m_size == 0)
+			return file;
+
+		file->m_mapping = CreateFileMappingW(file->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (!file->m_mapping)
+		{
+			std::cerr << "failed to map " << path << std::endl;
+			return nullptr;
+		}
+
+		file->m_data = static_cast<const char *>(MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		const auto fd = ::open(path.c_str(), O_RDONLY);
+
+		if (fd < 0)
+		{
+			std::cerr << "failed to open " << path << std::endl;
+			return nullptr;
+		}
+
+		struct stat info{};
+
+		if (fstat(fd, &info) != 0)
+		{
+			std::cerr << "failed to get size of " << path << std::endl;
+			::close(fd);
+			return nullptr;
+		}
+
+		file->m_size = static_cast<usize>(info.st_size);
+
+		if (file->m_size == 0)
+		{
+			::close(fd);
+			return file;
+		}
+
+		auto *data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		// the mapping keeps the file alive
+		::close(fd);
+
+		if (data == MAP_FAILED)
+		{
+			std::cerr << "failed to map " << path << std::endl;
+			return nullptr;
+		}
+
+		file->m_data = static_cast<const char *>(data);
+#endif
+
+		if (!file->m_data)
+		{
+			std::cerr << "failed to map " << path << std::endl;
+			return nullptr;
+		}
+
+		return file;
+	}
+}
@@ -0,0 +1,56 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+#include <memory>
+#include <filesystem>
+
+namespace oranj::util
+{
+	// read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+		[[nodiscard]] static auto open(const std::filesystem::path &path) -> std::unique_ptr<MappedFile>;
+
+		[[nodiscard]] inline auto data() const -> std::span<const char>
+		{
+			return {m_data, m_size};
+		}
+
+	private:
+		MappedFile() = default;
+
+		const char *m_data{};
+		usize m_size{};
+
+#ifdef _WIN32
+		void *m_file{};
+		void *m_mapping{};
+#endif
+	};
+}
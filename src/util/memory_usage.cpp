@@ -0,0 +1,55 @@
+/*
+ * oranj, a UCI shatranj engine
+ * Copyright (C) 2025 Ciekce
+ *
+ * oranj is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * oranj is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with oranj. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory_usage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace oranj::util
+{
+	auto peakRssBytes() -> std::optional<usize>
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters{};
+
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return {};
+
+		return static_cast<usize>(counters.PeakWorkingSetSize);
+#else
+		rusage usage{};
+
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return {};
+
+#ifdef __APPLE__
+		// bytes on macos, kilobytes everywhere else
+		return static_cast<usize>(usage.ru_maxrss);
+#else
+		return static_cast<usize>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+}
@@ -21,6 +21,8 @@
 #include "../types.h"
 
 #include <istream>
+#include <ostream>
+#include <vector>
 #include <span>
 #include <cassert>
 #include <limits>
@@ -80,4 +82,42 @@ namespace oranj::util
 	private:
 		MemoryBuffer m_buf;
 	};
+
+	// appends everything written to it to a vector, which the
+	// owner is free to clear or swap out between writes
+	class VectorBuffer : public std::streambuf
+	{
+	public:
+		explicit VectorBuffer(std::vector<u8> &dst)
+			: m_dst{dst} {}
+
+	protected:
+		auto overflow(int_type c) -> int_type override
+		{
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+				m_dst.push_back(static_cast<u8>(traits_type::to_char_type(c)));
+			return traits_type::not_eof(c);
+		}
+
+		auto xsputn(const char_type *s, std::streamsize n) -> std::streamsize override
+		{
+			const auto *begin = reinterpret_cast<const u8 *>(s);
+			m_dst.insert(m_dst.end(), begin, begin + n);
+			return n;
+		}
+
+	private:
+		std::vector<u8> &m_dst;
+	};
+
+	class VectorOstream : public std::ostream
+	{
+	public:
+		explicit VectorOstream(std::vector<u8> &dst)
+			: m_buf{dst},
+			  std::ostream{&m_buf} {}
+
+	private:
+		VectorBuffer m_buf;
+	};
 }
@@ -20,6 +20,7 @@
 
 #include "../types.h"
 
+#include <array>
 #include <limits>
 #include <bit>
 #include <random>
@@ -40,6 +41,10 @@ namespace oranj::util::rng
 			}
 		}
 
+		// resumes a generator from a previously saved state()
+		explicit constexpr Jsf64Rng(const std::array<u64, 4> &state)
+			: m_a{state[0]}, m_b{state[1]}, m_c{state[2]}, m_d{state[3]} {}
+
 		~Jsf64Rng() = default;
 
 		constexpr auto nextU64() -> u64
@@ -91,6 +96,11 @@ namespace oranj::util::rng
 
 		constexpr auto operator()() { return nextU64(); }
 
+		[[nodiscard]] constexpr auto state() const -> std::array<u64, 4>
+		{
+			return {m_a, m_b, m_c, m_d};
+		}
+
 		static constexpr auto min() { return std::numeric_limits<u64>::min(); }
 		static constexpr auto max() { return std::numeric_limits<u64>::max(); }
 
@@ -29,6 +29,11 @@ namespace oranj::util
 	public:
 		[[nodiscard]] auto elapsed() const -> f64;
 
+		[[nodiscard]] inline auto elapsedSince(const Instant &earlier) const -> f64
+		{
+			return m_time - earlier.m_time;
+		}
+
 		inline auto operator+(f64 time) const
 		{
 			return Instant{m_time + time};